@@ -0,0 +1,24 @@
+#ifndef BENCH_UTILS_H
+#define BENCH_UTILS_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "qtree.h"
+
+typedef enum BenchImageKind
+{
+    BENCH_IMAGE_NOISE,
+    BENCH_IMAGE_GRADIENT,
+    BENCH_IMAGE_FLAT,
+    BENCH_IMAGE_TEXTURED
+} BenchImageKind;
+
+double bench_now(void);
+Image *bench_synthetic_image(unsigned int width, unsigned int height, BenchImageKind kind);
+const char *bench_image_kind_name(BenchImageKind kind);
+int bench_trees_equal(QTNode *a, QTNode *b);
+int bench_files_equal(char *filename_a, char *filename_b);
+
+#endif // BENCH_UTILS_H
@@ -0,0 +1,102 @@
+#include "qtree.h"
+#include "image.h"
+#include "qtree_arena.h"
+
+#include "bench_utils.h"
+
+static int count_nodes(QTNode *node)
+{
+    if (!node) return 0;
+    int count = 1;
+    for (int i = 0; i < 4; i++) count += count_nodes(node->children[i]);
+    return count;
+}
+
+// Compares build and teardown time of malloc-per-node trees against arena-backed trees.
+// Run from the repository root: ./build/arena_bench [image.ppm] [repetitions]
+int main(int argc, char **argv)
+{
+    char *filename = argc > 1 ? argv[1] : "images/originals/einstein2.ppm";
+    int repetitions = argc > 2 ? atoi(argv[2]) : 5;
+    double thresholds[] = {0, 5, 25};
+
+    Image *image = load_image(filename);
+    if (!image)
+    {
+        ERROR("Failed to load %s", filename);
+        return 1;
+    }
+    printf("%s: %ux%u, %d repetitions (best of)\n", filename, image->width, image->height, repetitions);
+    printf("%9s %9s %13s %13s %13s %13s %13s %13s %s\n", "max_rmse", "nodes", "malloc build", "malloc del",
+           "arena build", "arena del", "reused build", "reused reset", "identical");
+
+    QTArena *reused_arena = create_qt_arena(0);
+    int failures = 0;
+    for (size_t t = 0; t < sizeof(thresholds) / sizeof(thresholds[0]); t++)
+    {
+        double malloc_build = 1e30, malloc_delete = 1e30, arena_build = 1e30, arena_delete = 1e30;
+        double reused_build = 1e30, reused_reset = 1e30;
+        int identical = 1, nodes = 0;
+        for (int rep = 0; rep < repetitions; rep++)
+        {
+            double start = bench_now();
+            QTNode *root = create_quadtree(image, thresholds[t]);
+            double built = bench_now();
+
+            QTArena *arena = create_qt_arena(0);
+            QTNode *arena_root = create_quadtree_arena(arena, image, thresholds[t]);
+            double arena_built = bench_now();
+
+            if (rep == 0)
+            {
+                identical = bench_trees_equal(root, arena_root);
+                nodes = count_nodes(root);
+            }
+
+            double delete_start = bench_now();
+            delete_quadtree(root);
+            double deleted = bench_now();
+            delete_qt_arena(arena);
+            double arena_deleted = bench_now();
+
+            if (built - start < malloc_build) malloc_build = built - start;
+            if (arena_built - built < arena_build) arena_build = arena_built - built;
+            if (deleted - delete_start < malloc_delete) malloc_delete = deleted - delete_start;
+            if (arena_deleted - deleted < arena_delete) arena_delete = arena_deleted - deleted;
+
+            // Steady state for a caller that rebuilds every frame: the arena keeps its largest block.
+            start = bench_now();
+            create_quadtree_arena(reused_arena, image, thresholds[t]);
+            built = bench_now();
+            reset_qt_arena(reused_arena);
+            deleted = bench_now();
+            if (built - start < reused_build) reused_build = built - start;
+            if (deleted - built < reused_reset) reused_reset = deleted - built;
+        }
+        printf("%9.1f %9d %10.3f ms %10.3f ms %10.3f ms %10.3f ms %10.3f ms %10.3f ms %s\n", thresholds[t], nodes,
+               malloc_build * 1e3, malloc_delete * 1e3, arena_build * 1e3, arena_delete * 1e3,
+               reused_build * 1e3, reused_reset * 1e3, identical ? "yes" : "NO");
+        if (!identical) failures++;
+    }
+
+    delete_qt_arena(reused_arena);
+
+    double text_load = 1e30, arena_text_load = 1e30;
+    for (int rep = 0; rep < repetitions; rep++)
+    {
+        double start = bench_now();
+        QTNode *root = load_preorder_qt("tests/input/load_preorder_qt1_qtree.txt");
+        delete_quadtree(root);
+        double middle = bench_now();
+        QTArena *arena = create_qt_arena(0);
+        load_preorder_qt_arena(arena, "tests/input/load_preorder_qt1_qtree.txt");
+        delete_qt_arena(arena);
+        double end = bench_now();
+        if (middle - start < text_load) text_load = middle - start;
+        if (end - middle < arena_text_load) arena_text_load = end - middle;
+    }
+    printf("load_preorder_qt + delete: malloc %.3f ms, arena %.3f ms\n", text_load * 1e3, arena_text_load * 1e3);
+
+    delete_image(image);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,152 @@
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "qtree.h"
+#include "image.h"
+#include "qtree_batch.h"
+
+#include "bench_utils.h"
+
+#define BATCH_BENCH_INPUT_DIR "tests/output/batch_bench_in"
+#define BATCH_BENCH_SERIAL_DIR "tests/output/batch_bench_serial"
+#define BATCH_BENCH_OUTPUT_DIR "tests/output/batch_bench_out"
+
+// The one-image-at-a-time loop the batch driver replaces.
+static int run_serial(char **inputs, size_t count, QTBatchOptions *options)
+{
+    char path[4096];
+    for (size_t i = 0; i < count; i++)
+    {
+        Image *image = load_image(inputs[i]);
+        QTNode *root = image ? create_quadtree(image, options->max_rmse) : NULL;
+        delete_image(image);
+        if (!root || !get_qt_batch_output_path(inputs[i], options, path, sizeof(path)))
+        {
+            delete_quadtree(root);
+            return 0;
+        }
+        if (options->output == QT_BATCH_PREORDER) save_preorder_qt(root, path);
+        else save_qtree_as_ppm_format(root, path, options->format);
+        delete_quadtree(root);
+    }
+    return 1;
+}
+
+static int outputs_equal(char **inputs, size_t count, QTBatchOptions *options, QTBatchOptions *reference)
+{
+    char path[4096], expected[4096];
+    for (size_t i = 0; i < count; i++)
+    {
+        if (!get_qt_batch_output_path(inputs[i], options, path, sizeof(path)) ||
+            !get_qt_batch_output_path(inputs[i], reference, expected, sizeof(expected)) || !bench_files_equal(path, expected))
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static void remove_outputs(char **inputs, size_t count, QTBatchOptions *options)
+{
+    char path[4096];
+    for (size_t i = 0; i < count; i++)
+    {
+        if (get_qt_batch_output_path(inputs[i], options, path, sizeof(path))) remove(path);
+    }
+}
+
+// Runs the pipeline with the given workers per stage and queue capacity against the serial
+// loop's time, checking every output file against the serial one.
+static int run_config(char **inputs, size_t count, QTBatchOptions *options, QTBatchOptions *serial, double serial_time,
+                      int load_workers, int build_workers, int save_workers, int capacity)
+{
+    options->workers[QT_BATCH_LOAD] = load_workers;
+    options->workers[QT_BATCH_BUILD] = build_workers;
+    options->workers[QT_BATCH_SAVE] = save_workers;
+    options->queue_capacity = capacity;
+    QTBatchReport report;
+    int ok = run_qt_batch(inputs, count, options, &report) && outputs_equal(inputs, count, options, serial);
+    remove_outputs(inputs, count, options);
+
+    char label[32];
+    snprintf(label, sizeof(label), "%d/%d/%d q%d", load_workers, build_workers, save_workers, capacity);
+    printf("%-16s %10.3f %10.1f %8.2fx", label, report.elapsed_seconds * 1e3, (double)report.completed / report.elapsed_seconds,
+           serial_time / report.elapsed_seconds);
+    for (int i = 0; i < QT_BATCH_STAGE_COUNT; i++)
+    {
+        printf(" %8.1f/%-7.1f", report.stages[i].busy_seconds * 1e3, report.stages[i].blocked_seconds * 1e3);
+    }
+    printf(" %s\n", ok ? "yes" : "NO");
+    return ok ? 0 : 1;
+}
+
+static int run_output(char **inputs, size_t count, QTBatchOutput output, ImageFormat format, double max_rmse)
+{
+    QTBatchOptions serial, options;
+    init_qt_batch_options(&serial, max_rmse, output, BATCH_BENCH_SERIAL_DIR);
+    init_qt_batch_options(&options, max_rmse, output, BATCH_BENCH_OUTPUT_DIR);
+    serial.format = options.format = format;
+
+    double start = bench_now();
+    int failures = !run_serial(inputs, count, &serial);
+    double serial_time = bench_now() - start;
+    printf("%-16s %10.3f %10.1f %8s\n", output == QT_BATCH_PREORDER ? "serial preorder" : "serial ppm", serial_time * 1e3,
+           (double)count / serial_time, "1.00x");
+
+    int configs[][4] = {{1, 1, 1, 1}, {1, 1, 1, 8}, {2, 2, 2, 8}, {1, 4, 1, 4}, {4, 4, 4, 16}};
+    for (size_t i = 0; !failures && i < sizeof(configs) / sizeof(configs[0]); i++)
+    {
+        failures += run_config(inputs, count, &options, &serial, serial_time, configs[i][0], configs[i][1], configs[i][2], configs[i][3]);
+    }
+    remove_outputs(inputs, count, &serial);
+    return failures;
+}
+
+// Writes a directory of synthetic P3 images and processes it with the serial loop and with
+// the batch pipeline at several worker counts (load/build/save) and queue capacities.
+// Busy/blocked columns are each stage's summed work and back-pressure time in ms.
+// Run from the repository root: ./build/batch_bench [images] [side]
+int main(int argc, char **argv)
+{
+    size_t count = (size_t)(argc > 1 ? atoi(argv[1]) : 24);
+    unsigned int side = (unsigned int)(argc > 2 ? atoi(argv[2]) : 512);
+    mkdir("tests/output", 0700);
+    mkdir(BATCH_BENCH_INPUT_DIR, 0700);
+    mkdir(BATCH_BENCH_SERIAL_DIR, 0700);
+    mkdir(BATCH_BENCH_OUTPUT_DIR, 0700);
+
+    char **inputs = (char **)calloc(count, sizeof(char *));
+    if (!inputs) return 1;
+    int failures = 0;
+    BenchImageKind kinds[] = {BENCH_IMAGE_TEXTURED, BENCH_IMAGE_NOISE, BENCH_IMAGE_GRADIENT, BENCH_IMAGE_FLAT};
+    for (size_t i = 0; i < count && !failures; i++)
+    {
+        inputs[i] = (char *)malloc(256);
+        Image *image = bench_synthetic_image(side + (unsigned int)i, side, kinds[i % 4]);
+        if (!inputs[i] || !image) failures++;
+        else
+        {
+            snprintf(inputs[i], 256, "%s/image%03zu.ppm", BATCH_BENCH_INPUT_DIR, i);
+            if (!save_image(image, inputs[i], IMAGE_FORMAT_P3)) failures++;
+        }
+        delete_image(image);
+    }
+
+    printf("%zu images of about %ux%u\n\n", count, side, side);
+    printf("%-16s %10s %10s %9s %16s %16s %16s %s\n", "workers", "total(ms)", "images/s", "speedup", "load busy/blk", "build busy/blk",
+           "save busy/blk", "identical");
+    if (!failures) failures += run_output(inputs, count, QT_BATCH_PREORDER, IMAGE_FORMAT_P3, 10);
+    if (!failures) failures += run_output(inputs, count, QT_BATCH_PPM, IMAGE_FORMAT_P6, 10);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        if (inputs[i]) remove(inputs[i]);
+        free(inputs[i]);
+    }
+    free(inputs);
+    rmdir(BATCH_BENCH_INPUT_DIR);
+    rmdir(BATCH_BENCH_SERIAL_DIR);
+    rmdir(BATCH_BENCH_OUTPUT_DIR);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,80 @@
+#include "bench_utils.h"
+
+double bench_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+// Deterministic images so runs are comparable across machines and commits.
+Image *bench_synthetic_image(unsigned int width, unsigned int height, BenchImageKind kind)
+{
+    Image *image = create_image(width, height, 1);
+    if (!image) return NULL;
+    unsigned int state = 2463534242u;
+    for (unsigned int row = 0; row < height; row++)
+    {
+        for (unsigned int col = 0; col < width; col++)
+        {
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+            unsigned int gradient = (unsigned int)(((unsigned long long)(row + col) * 255) / ((unsigned long long)width + height));
+            unsigned int value;
+            switch (kind)
+            {
+                case BENCH_IMAGE_NOISE: value = state & 0xFF; break;
+                case BENCH_IMAGE_GRADIENT: value = gradient; break;
+                case BENCH_IMAGE_FLAT: value = 128; break;
+                default:
+                    // Smooth background with noisy 64x64 patches on a checkerboard.
+                    value = ((row / 64 + col / 64) % 4 == 0) ? (gradient + (state & 0x3F)) % 256 : gradient;
+                    break;
+            }
+            image->data[(size_t)row * width + col] = (unsigned char)value;
+        }
+    }
+    return image;
+}
+
+const char *bench_image_kind_name(BenchImageKind kind)
+{
+    switch (kind)
+    {
+        case BENCH_IMAGE_NOISE: return "noise";
+        case BENCH_IMAGE_GRADIENT: return "gradient";
+        case BENCH_IMAGE_FLAT: return "flat";
+        default: return "textured";
+    }
+}
+
+int bench_trees_equal(QTNode *a, QTNode *b)
+{
+    if (!a || !b) return a == b;
+    if (a->is_leaf != b->is_leaf || a->intensity != b->intensity) return 0;
+    if (a->width != b->width || a->height != b->height) return 0;
+    if (a->is_leaf) return 1;
+    for (int i = 0; i < 4; i++)
+    {
+        if (!bench_trees_equal(a->children[i], b->children[i])) return 0;
+    }
+    return 1;
+}
+
+int bench_files_equal(char *filename_a, char *filename_b)
+{
+    FILE *file_a = fopen(filename_a, "rb");
+    FILE *file_b = fopen(filename_b, "rb");
+    int equal = file_a && file_b;
+    while (equal)
+    {
+        int ch_a = fgetc(file_a);
+        int ch_b = fgetc(file_b);
+        if (ch_a != ch_b) equal = 0;
+        if (ch_a == EOF) break;
+    }
+    if (file_a) fclose(file_a);
+    if (file_b) fclose(file_b);
+    return equal;
+}
@@ -0,0 +1,90 @@
+#include <sys/stat.h>
+
+#include "qtree.h"
+#include "image.h"
+#include "qtree_binary.h"
+
+#include "bench_utils.h"
+
+static long long file_size(char *filename)
+{
+    struct stat st;
+    return stat(filename, &st) == 0 ? (long long)st.st_size : -1;
+}
+
+static double time_tree_loader(QTNode *(*loader)(char *), char *filename, int repetitions)
+{
+    double best = 1e30;
+    for (int rep = 0; rep < repetitions; rep++)
+    {
+        double start = bench_now();
+        QTNode *root = loader(filename);
+        double elapsed = bench_now() - start;
+        delete_quadtree(root);
+        if (elapsed < best) best = elapsed;
+    }
+    return best;
+}
+
+// Saves the tree in both formats, checks that each loads back to the same tree and that
+// the text -> binary -> text conversion is lossless, then compares sizes and load times.
+static int run_case(char *label, QTNode *root, int repetitions)
+{
+    char *text_filename = "tests/output/binary_bench_qtree.txt";
+    char *binary_filename = "tests/output/binary_bench_qtree.qtb";
+    char *converted_filename = "tests/output/binary_bench_converted.txt";
+
+    int saved = save_preorder_qt(root, text_filename) && save_binary_qt(root, binary_filename);
+    QTNode *loaded = saved ? load_binary_qt(binary_filename) : NULL;
+    int identical = saved && bench_trees_equal(root, loaded);
+    delete_quadtree(loaded);
+    identical = identical && convert_preorder_qt_to_binary(text_filename, binary_filename) &&
+                convert_binary_qt_to_preorder(binary_filename, converted_filename) &&
+                bench_files_equal(text_filename, converted_filename);
+
+    long long text_bytes = file_size(text_filename);
+    long long binary_bytes = file_size(binary_filename);
+    double text_time = time_tree_loader(load_preorder_qt, text_filename, repetitions);
+    double binary_time = time_tree_loader(load_binary_qt, binary_filename, repetitions);
+    printf("%-24s %10lld %10lld %7.1fx %11.3f %11.3f %7.1fx %s\n", label, text_bytes, binary_bytes,
+           (double)text_bytes / (double)binary_bytes, text_time * 1e3, binary_time * 1e3, text_time / binary_time,
+           identical ? "yes" : "NO");
+    return identical ? 0 : 1;
+}
+
+// Compares the text and binary preorder formats on the reference tree and larger builds.
+// Run from the repository root: ./build/binary_bench [repetitions]
+int main(int argc, char **argv)
+{
+    int repetitions = argc > 1 ? atoi(argv[1]) : 5;
+    mkdir("tests/output", 0700);
+
+    printf("%-24s %10s %10s %8s %11s %11s %8s %s\n", "tree", "text B", "binary B", "ratio", "text ms", "binary ms",
+           "speedup", "round-trip");
+    int failures = 0;
+    QTNode *root = load_preorder_qt("tests/input/load_preorder_qt1_qtree.txt");
+    if (root)
+    {
+        failures += run_case("load_preorder_qt1", root, repetitions);
+        delete_quadtree(root);
+    }
+
+    Image *image = load_image("images/originals/einstein2.ppm");
+    if (image)
+    {
+        root = create_quadtree(image, 5);
+        failures += run_case("einstein2 rmse 5", root, repetitions);
+        delete_quadtree(root);
+        delete_image(image);
+    }
+
+    image = bench_synthetic_image(2048, 2048, BENCH_IMAGE_TEXTURED);
+    if (image)
+    {
+        root = create_quadtree(image, 10);
+        failures += run_case("textured 2048 rmse 10", root, repetitions);
+        delete_quadtree(root);
+        delete_image(image);
+    }
+    return failures ? 1 : 0;
+}
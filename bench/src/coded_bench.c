@@ -0,0 +1,156 @@
+#include <sys/stat.h>
+#include <string.h>
+
+#include "qtree.h"
+#include "image.h"
+#include "qtree_binary.h"
+#include "qtree_coded.h"
+
+#include "bench_utils.h"
+
+static long file_size(char *filename)
+{
+    struct stat st;
+    return stat(filename, &st) == 0 ? (long)st.st_size : -1;
+}
+
+#define CODED_BENCH_NODES 1024
+
+// Decodes the whole stream a batch at a time without building a tree.
+static int stream_coded_nodes(char *filename, unsigned long long *node_count)
+{
+    QTCodedReader *reader = open_coded_qt_reader(filename);
+    if (!reader) return 0;
+    QTCodedNode nodes[CODED_BENCH_NODES];
+    int count;
+    *node_count = 0;
+    while ((count = read_coded_qt_nodes(reader, nodes, CODED_BENCH_NODES)) > 0) *node_count += (unsigned long long)count;
+    int ok = !reader->failed;
+    close_coded_qt_reader(reader);
+    return ok;
+}
+
+// Compares the coded container with the plain binary one on size and load time, and
+// reports the streaming decoder's best rate in nodes and in MB/s of the binary file the
+// same tree would take, checking every tree.
+static int run_case(char *label, QTNode *root, int repeats)
+{
+    char *binary_file = "tests/output/coded_bench.qtb";
+    char *coded_file = "tests/output/coded_bench.qtc";
+    int ok = save_binary_qt(root, binary_file);
+    double start = bench_now();
+    ok = save_coded_qt(root, coded_file) && ok;
+    double encode_time = bench_now() - start;
+
+    double binary_time = 1e30, coded_time = 1e30, stream_time = 1e30;
+    unsigned long long node_count = 0;
+    for (int i = 0; ok && i < repeats; i++)
+    {
+        start = bench_now();
+        QTNode *binary = load_binary_qt(binary_file);
+        double loaded = bench_now();
+        QTNode *coded = load_coded_qt(coded_file);
+        double decoded = bench_now();
+        int streamed_ok = stream_coded_nodes(coded_file, &node_count);
+        double streamed = bench_now();
+        ok = streamed_ok && bench_trees_equal(root, coded) && bench_trees_equal(root, binary);
+        if (loaded - start < binary_time) binary_time = loaded - start;
+        if (decoded - loaded < coded_time) coded_time = decoded - loaded;
+        if (streamed - decoded < stream_time) stream_time = streamed - decoded;
+        delete_quadtree(binary);
+        delete_quadtree(coded);
+    }
+
+    long binary_size = file_size(binary_file), coded_size = file_size(coded_file);
+    printf("%-20s %9llu %10ld %10ld %6.1f%% %10.3f %10.3f %10.3f %9.1f %9.1f %s\n", label, node_count, binary_size, coded_size,
+           100.0 * coded_size / binary_size, encode_time * 1e3, binary_time * 1e3, coded_time * 1e3, node_count * 1e-6 / stream_time,
+           binary_size * 1e-6 / stream_time, ok ? "yes" : "NO");
+    remove(binary_file);
+    remove(coded_file);
+    return ok ? 0 : 1;
+}
+
+// Corrupts a few random bytes of a valid coded file, past its header, `count` times; each
+// copy must either fail cleanly or decode to a whole tree. Returns how many decoded.
+static int fuzz_coded_file(char *filename, int count)
+{
+    char *fuzz_file = "tests/output/coded_bench_fuzz.qtc";
+    long size = file_size(filename);
+    FILE *file = fopen(filename, "rb");
+    unsigned char *original = size > QT_CODED_HEADER_SIZE ? (unsigned char *)malloc((size_t)size) : NULL;
+    unsigned char *corrupt = original ? (unsigned char *)malloc((size_t)size) : NULL;
+    int decoded = 0;
+    if (file && corrupt && fread(original, 1, (size_t)size, file) == (size_t)size)
+    {
+        unsigned int state = 0x9E3779B9u;
+        for (int i = 0; i < count; i++)
+        {
+            memcpy(corrupt, original, (size_t)size);
+            for (int j = 0; j < 4; j++)
+            {
+                state ^= state << 13;
+                state ^= state >> 17;
+                state ^= state << 5;
+                corrupt[QT_CODED_HEADER_SIZE + state % (unsigned int)(size - QT_CODED_HEADER_SIZE)] ^= (unsigned char)(1 + (state >> 24) % 255);
+            }
+            FILE *out = fopen(fuzz_file, "wb");
+            if (!out) break;
+            fwrite(corrupt, 1, (size_t)size, out);
+            fclose(out);
+            unsigned long long node_count;
+            if (stream_coded_nodes(fuzz_file, &node_count)) decoded++;
+        }
+    }
+    if (file) fclose(file);
+    free(original);
+    free(corrupt);
+    remove(fuzz_file);
+    return decoded;
+}
+
+// Round-trips tests/input/load_preorder_qt1_qtree.txt through the coded container, then
+// compares coded and binary trees of einstein2.ppm and synthetic images.
+// Run from the repository root: ./build/coded_bench [repeats]
+int main(int argc, char **argv)
+{
+    int repeats = argc > 1 ? atoi(argv[1]) : 5;
+    mkdir("tests/output", 0700);
+
+    char *input = "tests/input/load_preorder_qt1_qtree.txt";
+    char *coded = "tests/output/coded_bench_qt1.qtc";
+    char *binary = "tests/output/coded_bench_qt1.qtb";
+    char *round_trip = "tests/output/coded_bench_qt1.txt";
+    int failures = !(convert_preorder_qt_to_coded(input, coded) && convert_coded_qt_to_preorder(coded, round_trip) &&
+                     bench_files_equal(input, round_trip) && convert_preorder_qt_to_binary(input, binary));
+    printf("%s: text %ld, binary %ld, coded %ld bytes, round trip %s\n\n", input, file_size(input), file_size(binary), file_size(coded),
+           failures ? "DIFFERENT" : "identical");
+    printf("%d of 2000 corrupted copies decoded, the rest rejected\n\n", fuzz_coded_file(coded, 2000));
+    remove(coded);
+    remove(binary);
+    remove(round_trip);
+
+    printf("%-20s %9s %10s %10s %7s %10s %10s %10s %9s %9s %s\n", "tree", "nodes", "binary", "coded", "ratio", "encode(ms)", "bin load", "coded load",
+           "Mnodes/s", "MB/s", "identical");
+    Image *image = load_image("images/originals/einstein2.ppm");
+    double thresholds[] = {0, 5, 25};
+    for (size_t t = 0; image && t < sizeof(thresholds) / sizeof(thresholds[0]); t++)
+    {
+        char label[32];
+        snprintf(label, sizeof(label), "einstein2 rmse %g", thresholds[t]);
+        QTNode *root = create_quadtree(image, thresholds[t]);
+        failures += run_case(label, root, repeats);
+        delete_quadtree(root);
+    }
+    delete_image(image);
+
+    BenchImageKind kinds[] = {BENCH_IMAGE_GRADIENT, BENCH_IMAGE_TEXTURED, BENCH_IMAGE_NOISE};
+    for (size_t k = 0; k < sizeof(kinds) / sizeof(kinds[0]); k++)
+    {
+        image = bench_synthetic_image(1024, 1024, kinds[k]);
+        QTNode *root = image ? create_quadtree(image, 10) : NULL;
+        if (root) failures += run_case((char *)bench_image_kind_name(kinds[k]), root, repeats);
+        delete_quadtree(root);
+        delete_image(image);
+    }
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,84 @@
+#include "qtree.h"
+#include "image.h"
+
+#include "bench_utils.h"
+
+// create_quadtree as it was before early splits: every node scans its whole region.
+static QTNode *full_scan_quadtree(Image *image, QTRegion region, double max_rmse)
+{
+    QTNode *node = (QTNode *)malloc(sizeof(QTNode));
+    if (!node) return NULL;
+    node->width = region.width;
+    node->height = region.height;
+    node->is_leaf = evaluate_qt_region(image, region, max_rmse, &node->intensity);
+    QTRegion children[4];
+    split_qt_region(region, children);
+    for (int i = 0; i < 4; i++)
+    {
+        node->children[i] = !node->is_leaf && children[i].width > 0 ? full_scan_quadtree(image, children[i], max_rmse) : NULL;
+    }
+    return node;
+}
+
+static unsigned long long count_nodes(QTNode *node)
+{
+    if (!node) return 0;
+    unsigned long long count = 1;
+    for (int i = 0; i < 4; i++) count += count_nodes(node->children[i]);
+    return count;
+}
+
+// Best of `repeats` builds each way; the trees, internal intensities included, must match.
+static int run_case(const char *label, Image *image, double max_rmse, int repeats)
+{
+    QTRegion region = {0, 0, (int)image->width, (int)image->height};
+    double full_time = 1e30, early_time = 1e30;
+    int identical = 1;
+    unsigned long long nodes = 0;
+    for (int rep = 0; rep < repeats; rep++)
+    {
+        double start = bench_now();
+        QTNode *expected = full_scan_quadtree(image, region, max_rmse);
+        double middle = bench_now();
+        QTNode *actual = create_quadtree(image, max_rmse);
+        double end = bench_now();
+        if (middle - start < full_time) full_time = middle - start;
+        if (end - middle < early_time) early_time = end - middle;
+        if (!bench_trees_equal(expected, actual)) identical = 0;
+        nodes = count_nodes(actual);
+        delete_quadtree(expected);
+        delete_quadtree(actual);
+    }
+    printf("%-20s %8.1f %10llu %12.3f %12.3f %8.2fx %s\n", label, max_rmse, nodes, full_time * 1e3, early_time * 1e3, full_time / early_time,
+           identical ? "yes" : "NO");
+    return identical ? 0 : 1;
+}
+
+// Times create_quadtree, whose busy regions stop scanning once their RMSE is provably over
+// the threshold, against full scans of every region.
+// Run from the repository root: ./build/early_split_bench [synthetic side] [repeats]
+int main(int argc, char **argv)
+{
+    unsigned int side = (unsigned int)(argc > 1 ? atoi(argv[1]) : 2048);
+    int repeats = argc > 2 ? atoi(argv[2]) : 3;
+    printf("%-20s %8s %10s %12s %12s %9s %s\n", "image", "max_rmse", "nodes", "full(ms)", "early(ms)", "speedup", "identical");
+    int failures = 0;
+    double thresholds[] = {0, 5, 10, 25, 50};
+    Image *image = load_image("images/originals/einstein2.ppm");
+    for (size_t i = 0; image && i < sizeof(thresholds) / sizeof(thresholds[0]); i++)
+    {
+        failures += run_case("einstein2", image, thresholds[i], repeats);
+    }
+    delete_image(image);
+
+    BenchImageKind kinds[] = {BENCH_IMAGE_NOISE, BENCH_IMAGE_TEXTURED, BENCH_IMAGE_GRADIENT, BENCH_IMAGE_FLAT};
+    for (size_t k = 0; k < sizeof(kinds) / sizeof(kinds[0]); k++)
+    {
+        image = bench_synthetic_image(side, side, kinds[k]);
+        if (!image) continue;
+        failures += run_case(bench_image_kind_name(kinds[k]), image, 10, repeats);
+        failures += run_case(bench_image_kind_name(kinds[k]), image, 60, repeats);
+        delete_image(image);
+    }
+    return failures ? 1 : 0;
+}
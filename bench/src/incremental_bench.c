@@ -0,0 +1,88 @@
+#include "qtree.h"
+#include "image.h"
+#include "qtree_incremental.h"
+
+#include "bench_utils.h"
+
+static unsigned int next_random(unsigned int *state)
+{
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+    return *state;
+}
+
+// Paints a side x side square with either noise or a flat value, like an annotation.
+static QTRegion paint_square(Image *image, unsigned int *state, int side)
+{
+    QTRegion dirty;
+    dirty.row = (int)(next_random(state) % (image->height - (unsigned int)side));
+    dirty.col = (int)(next_random(state) % (image->width - (unsigned int)side));
+    dirty.width = side;
+    dirty.height = side;
+    int noisy = next_random(state) & 1;
+    unsigned char flat = (unsigned char)next_random(state);
+    for (int row = dirty.row; row < dirty.row + side; row++)
+    {
+        for (int col = dirty.col; col < dirty.col + side; col++)
+        {
+            image->data[(size_t)row * image->width + col] = noisy ? (unsigned char)next_random(state) : flat;
+        }
+    }
+    return dirty;
+}
+
+static int run_case(char *label, Image *image, double max_rmse, int side, int frames)
+{
+    QTIncremental *tracker = create_qt_incremental(create_quadtree(image, max_rmse), image, max_rmse);
+    if (!tracker) return 1;
+
+    unsigned int state = 2463534242u;
+    double update_time = 0, rebuild_time = 0;
+    int identical = 1;
+    for (int frame = 0; frame < frames; frame++)
+    {
+        QTRegion dirty = paint_square(image, &state, side);
+        double start = bench_now();
+        if (!update_qt_incremental(tracker, image, dirty)) identical = 0;
+        double updated = bench_now();
+        QTNode *rebuilt = create_quadtree(image, max_rmse);
+        double end = bench_now();
+        update_time += updated - start;
+        rebuild_time += end - updated;
+        if (!bench_trees_equal(tracker->root, rebuilt)) identical = 0;
+        delete_quadtree(rebuilt);
+    }
+    printf("%-24s %6d %14.3f %14.3f %8.1fx %s\n", label, side, update_time * 1e3 / frames, rebuild_time * 1e3 / frames,
+           rebuild_time / update_time, identical ? "yes" : "NO");
+    delete_qt_incremental(tracker);
+    return identical ? 0 : 1;
+}
+
+// Edits random squares of an image frame by frame and compares update_qt_incremental with
+// rebuilding the whole tree, checking the trees match after every frame.
+// Run from the repository root: ./build/incremental_bench [frames]
+int main(int argc, char **argv)
+{
+    int frames = argc > 1 ? atoi(argv[1]) : 20;
+    int sides[] = {8, 64, 256};
+
+    printf("%-24s %6s %14s %14s %9s %s\n", "image", "edit", "update(ms)", "rebuild(ms)", "speedup", "identical");
+    int failures = 0;
+    for (size_t s = 0; s < sizeof(sides) / sizeof(sides[0]); s++)
+    {
+        Image *image = load_image("images/originals/einstein2.ppm");
+        if (image)
+        {
+            failures += run_case("einstein2 rmse 5", image, 5, sides[s], frames);
+            delete_image(image);
+        }
+        image = bench_synthetic_image(4096, 4096, BENCH_IMAGE_TEXTURED);
+        if (image)
+        {
+            failures += run_case("textured 4096 rmse 10", image, 10, sides[s], frames);
+            delete_image(image);
+        }
+    }
+    return failures ? 1 : 0;
+}
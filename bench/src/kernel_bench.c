@@ -0,0 +1,130 @@
+#include <math.h>
+
+#include "qtree.h"
+#include "image.h"
+#include "region_sums.h"
+
+#include "bench_utils.h"
+
+// The original per-pixel mean and RMSE (get_image_intensity and pow), kept as the
+// reference the vectorized evaluate_qt_region must reproduce bit for bit.
+static double reference_rmse(Image *image, QTRegion region, unsigned char *intensity)
+{
+    double total_intensity = 0.0;
+    int pixel_count = region.width * region.height;
+    for (int i = region.row; i < region.row + region.height; i++)
+    {
+        for (int j = region.col; j < region.col + region.width; j++) total_intensity += get_image_intensity(image, i, j);
+    }
+    *intensity = (unsigned char)(total_intensity / pixel_count);
+
+    double rmse = 0.0;
+    for (int i = region.row; i < region.row + region.height; i++)
+    {
+        for (int j = region.col; j < region.col + region.width; j++) rmse += pow(get_image_intensity(image, i, j) - *intensity, 2);
+    }
+    return sqrt(rmse / pixel_count);
+}
+
+static QTNode *create_quadtree_reference(Image *image, QTRegion region, double max_rmse)
+{
+    QTNode *node = (QTNode *)malloc(sizeof(QTNode));
+    node->width = region.width;
+    node->height = region.height;
+    for (int i = 0; i < 4; i++) node->children[i] = NULL;
+    double rmse = reference_rmse(image, region, &node->intensity);
+    node->is_leaf = rmse <= max_rmse || (region.width <= 1 && region.height <= 1);
+    if (node->is_leaf) return node;
+
+    QTRegion children[4];
+    split_qt_region(region, children);
+    for (int i = 0; i < 4; i++)
+    {
+        if (children[i].width > 0) node->children[i] = create_quadtree_reference(image, children[i], max_rmse);
+    }
+    return node;
+}
+
+// Evaluating each region exactly at, and one ulp below, its reference RMSE only gives the
+// reference decisions if the vectorized RMSE is bit-identical.
+static int decisions_exact(Image *image, int regions)
+{
+    unsigned int state = 2463534242u;
+    for (int i = 0; i < regions; i++)
+    {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        QTRegion region;
+        region.row = (int)(state % image->height);
+        region.col = (int)((state >> 8) % image->width);
+        region.height = 1 + (int)((state >> 4) % (unsigned int)(image->height - region.row));
+        region.width = 1 + (int)((state >> 12) % (unsigned int)(image->width - region.col));
+        if (region.width * region.height < 2) continue;
+
+        unsigned char expected, actual;
+        double rmse = reference_rmse(image, region, &expected);
+        if (!evaluate_qt_region(image, region, rmse, &actual) || actual != expected) return 0;
+        if (rmse > 0 && evaluate_qt_region(image, region, nextafter(rmse, 0), &actual)) return 0;
+    }
+    return 1;
+}
+
+static int run_case(char *label, Image *image, double max_rmse, int repetitions)
+{
+    RegionSumsKernel kernels[] = {REGION_SUMS_SCALAR, REGION_SUMS_SSE2, REGION_SUMS_AVX2};
+    QTRegion region = {0, 0, image->width, image->height};
+
+    double start = bench_now();
+    QTNode *reference = create_quadtree_reference(image, region, max_rmse);
+    double reference_time = bench_now() - start;
+    printf("%-24s %-8s %12.3f %9s %s\n", label, "pow", reference_time * 1e3, "1.00x", "-");
+
+    int failures = 0;
+    for (size_t k = 0; k < sizeof(kernels) / sizeof(kernels[0]); k++)
+    {
+        if (!select_region_sums_kernel(kernels[k])) continue;
+        double best = 1e30;
+        int identical = decisions_exact(image, 2000);
+        for (int rep = 0; rep < repetitions; rep++)
+        {
+            start = bench_now();
+            QTNode *root = create_quadtree(image, max_rmse);
+            double elapsed = bench_now() - start;
+            if (elapsed < best) best = elapsed;
+            if (rep == 0 && !bench_trees_equal(reference, root)) identical = 0;
+            delete_quadtree(root);
+        }
+        printf("%-24s %-8s %12.3f %8.2fx %s\n", label, region_sums_kernel_name(), best * 1e3, reference_time / best,
+               identical ? "yes" : "NO");
+        if (!identical) failures++;
+    }
+    select_region_sums_kernel(REGION_SUMS_AUTO);
+    delete_quadtree(reference);
+    return failures;
+}
+
+// Times create_quadtree with each region-sum kernel against the original pow-based scan
+// and checks that trees and RMSE decisions are bit-identical.
+// Run from the repository root: ./build/kernel_bench [repetitions]
+int main(int argc, char **argv)
+{
+    int repetitions = argc > 1 ? atoi(argv[1]) : 5;
+
+    printf("%-24s %-8s %12s %9s %s\n", "image", "kernel", "build(ms)", "speedup", "identical");
+    int failures = 0;
+    Image *image = load_image("images/originals/einstein2.ppm");
+    if (image)
+    {
+        failures += run_case("einstein2 rmse 5", image, 5, repetitions);
+        delete_image(image);
+    }
+
+    image = bench_synthetic_image(2048, 2048, BENCH_IMAGE_NOISE);
+    if (image)
+    {
+        failures += run_case("noise 2048 rmse 25", image, 25, repetitions);
+        delete_image(image);
+    }
+    return failures ? 1 : 0;
+}
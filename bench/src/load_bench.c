@@ -0,0 +1,128 @@
+#include <dirent.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "image.h"
+
+#include "bench_utils.h"
+
+// The original fscanf-per-pixel loader, kept as the baseline and as the reference
+// the buffered load_image must reproduce exactly.
+static Image *load_image_fscanf(char *filename)
+{
+    FILE *file = fopen(filename, "r");
+    if (!file) return NULL;
+
+    char format[3];
+    if (fscanf(file, "%2s", format) != 1 || strcmp(format, "P3") != 0)
+    {
+        fclose(file);
+        return NULL;
+    }
+
+    int ch;
+    do
+    {
+        ch = fgetc(file);
+        if (ch == '#') while (fgetc(file) != '\n');
+    }
+    while (ch == '#' || ch == '\n');
+    ungetc(ch, file);
+
+    unsigned short width, height, max_value;
+    if (fscanf(file, "%hu %hu %hu", &width, &height, &max_value) != 3 || max_value != 255)
+    {
+        fclose(file);
+        return NULL;
+    }
+
+    Image *image = create_image(width, height, 3);
+    unsigned int r, g, b;
+    for (unsigned int i = 0; i < (unsigned int)(width * height); i++)
+    {
+        if (fscanf(file, "%u %u %u", &r, &g, &b) != 3)
+        {
+            delete_image(image);
+            fclose(file);
+            return NULL;
+        }
+        image->data[3 * i] = (unsigned char)r;
+        image->data[3 * i + 1] = (unsigned char)g;
+        image->data[3 * i + 2] = (unsigned char)b;
+    }
+    fclose(file);
+    return image;
+}
+
+static int images_equal(Image *a, Image *b)
+{
+    if (!a || !b) return a == b;
+    if (a->width != b->width || a->height != b->height) return 0;
+    for (unsigned int row = 0; row < a->height; row++)
+    {
+        for (unsigned int col = 0; col < a->width; col++)
+        {
+            if (get_image_intensity(a, row, col) != get_image_intensity(b, row, col)) return 0;
+        }
+    }
+    return 1;
+}
+
+static double time_loader(Image *(*loader)(char *), char *filename, int repetitions)
+{
+    double best = 1e30;
+    for (int rep = 0; rep < repetitions; rep++)
+    {
+        double start = bench_now();
+        Image *image = loader(filename);
+        double elapsed = bench_now() - start;
+        delete_image(image);
+        if (elapsed < best) best = elapsed;
+    }
+    return best;
+}
+
+// Reports parse throughput of load_image for every file in images/originals.
+// Run from the repository root: ./build/load_bench [directory] [repetitions]
+int main(int argc, char **argv)
+{
+    char *directory = argc > 1 ? argv[1] : "images/originals";
+    int repetitions = argc > 2 ? atoi(argv[2]) : 5;
+
+    DIR *dir = opendir(directory);
+    if (!dir)
+    {
+        ERROR("Failed to open directory %s", directory);
+        return 1;
+    }
+
+    printf("%-20s %10s %12s %12s %9s %s\n", "file", "bytes", "fscanf MB/s", "buffered MB/s", "speedup", "identical");
+    int failures = 0;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL)
+    {
+        size_t name_length = strlen(entry->d_name);
+        if (name_length < 4 || strcmp(entry->d_name + name_length - 4, ".ppm") != 0) continue;
+
+        char path[512];
+        snprintf(path, sizeof(path), "%s/%s", directory, entry->d_name);
+        struct stat st;
+        if (stat(path, &st) != 0) continue;
+        double megabytes = (double)st.st_size / (1024.0 * 1024.0);
+
+        Image *reference = load_image_fscanf(path);
+        Image *image = load_image(path);
+        int identical = images_equal(reference, image);
+        delete_image(reference);
+        delete_image(image);
+        if (!identical) failures++;
+
+        double fscanf_time = time_loader(load_image_fscanf, path, repetitions);
+        double buffered_time = time_loader(load_image, path, repetitions);
+        printf("%-20s %10lld %12.1f %12.1f %8.2fx %s\n", entry->d_name, (long long)st.st_size,
+               megabytes / fscanf_time, megabytes / buffered_time, fscanf_time / buffered_time,
+               identical ? (image ? "yes" : "yes (rejected)") : "NO");
+    }
+    closedir(dir);
+    return failures ? 1 : 0;
+}
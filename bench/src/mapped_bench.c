@@ -0,0 +1,104 @@
+#include <sys/stat.h>
+
+#include "qtree.h"
+#include "image.h"
+#include "qtree_binary.h"
+#include "qtree_mapped.h"
+
+#include "bench_utils.h"
+
+// Checks every pixel of the mapped tree against render_quadtree and one materialized
+// quadrant against the in-memory subtree, then times open, point queries and full loads.
+static int run_case(char *label, QTNode *root, int repetitions)
+{
+    char *mapped_filename = "tests/output/mapped_bench_qtree.qtm";
+    char *binary_filename = "tests/output/mapped_bench_qtree.qtb";
+    int saved = save_mapped_qt(root, mapped_filename) && save_binary_qt(root, binary_filename);
+
+    MappedQTree *tree = saved ? open_mapped_qt(mapped_filename) : NULL;
+    unsigned char *pixels = render_quadtree(root);
+    int identical = tree && pixels;
+    for (int row = 0; identical && row < root->height; row++)
+    {
+        for (int col = 0; col < root->width; col++)
+        {
+            if (query_mapped_qt_point(tree, row, col) != pixels[(size_t)row * root->width + col]) identical = 0;
+        }
+    }
+    free(pixels);
+    if (identical)
+    {
+        QTNode *quadrant = materialize_mapped_subtree(tree, get_mapped_child4(tree, get_mapped_root(tree)));
+        identical = bench_trees_equal(root->is_leaf ? NULL : root->children[3], quadrant);
+        delete_quadtree(quadrant);
+    }
+    close_mapped_qt(tree);
+
+    double open_time = 1e30, query_time = 1e30, load_time = 1e30;
+    int queries = 100000;
+    unsigned int checksum = 0;
+    for (int rep = 0; rep < repetitions; rep++)
+    {
+        double start = bench_now();
+        tree = open_mapped_qt(mapped_filename);
+        double opened = bench_now();
+        unsigned int state = 2463534242u;
+        for (int i = 0; tree && i < queries; i++)
+        {
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+            checksum += query_mapped_qt_point(tree, (int)(state % (unsigned int)root->height), (int)((state >> 16) % (unsigned int)root->width));
+        }
+        double queried = bench_now();
+        close_mapped_qt(tree);
+
+        double load_start = bench_now();
+        QTNode *loaded = load_binary_qt(binary_filename);
+        double loaded_end = bench_now();
+        delete_quadtree(loaded);
+
+        if (opened - start < open_time) open_time = opened - start;
+        if (queried - opened < query_time) query_time = queried - opened;
+        if (loaded_end - load_start < load_time) load_time = loaded_end - load_start;
+    }
+    printf("%-24s %10.3f %12.1f %14.3f %s (checksum %u)\n", label, open_time * 1e6, query_time * 1e9 / queries,
+           load_time * 1e3, identical ? "yes" : "NO", checksum);
+    return identical ? 0 : 1;
+}
+
+// Compares opening a mapped tree and querying it in place with fully loading a binary tree.
+// Run from the repository root: ./build/mapped_bench [repetitions]
+int main(int argc, char **argv)
+{
+    int repetitions = argc > 1 ? atoi(argv[1]) : 5;
+    mkdir("tests/output", 0700);
+
+    printf("%-24s %10s %12s %14s %s\n", "tree", "open us", "ns/query", "full load ms", "identical");
+    int failures = 0;
+    QTNode *root = load_preorder_qt("tests/input/load_preorder_qt1_qtree.txt");
+    if (root)
+    {
+        failures += run_case("load_preorder_qt1", root, repetitions);
+        delete_quadtree(root);
+    }
+
+    Image *image = load_image("images/originals/einstein2.ppm");
+    if (image)
+    {
+        root = create_quadtree(image, 5);
+        failures += run_case("einstein2 rmse 5", root, repetitions);
+        delete_quadtree(root);
+        delete_image(image);
+    }
+
+    image = bench_synthetic_image(4096, 4096, BENCH_IMAGE_TEXTURED);
+    if (image)
+    {
+        root = create_quadtree(image, 10);
+        failures += run_case("textured 4096 rmse 10", root, repetitions);
+        delete_quadtree(root);
+        delete_image(image);
+    }
+    return failures ? 1 : 0;
+}
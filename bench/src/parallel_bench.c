@@ -0,0 +1,58 @@
+#include "qtree.h"
+#include "image.h"
+
+#include "bench_utils.h"
+
+static int run_scaling(char *label, Image *image, double max_rmse, int repetitions)
+{
+    int thread_counts[] = {1, 2, 4, 8, 16};
+    QTNode *reference = create_quadtree(image, max_rmse);
+    double serial_time = 0;
+    int failures = 0;
+
+    printf("%s (%ux%u, max_rmse %.1f)\n", label, image->width, image->height, max_rmse);
+    printf("%9s %12s %9s %s\n", "threads", "build(ms)", "speedup", "identical");
+    for (size_t t = 0; t < sizeof(thread_counts) / sizeof(thread_counts[0]); t++)
+    {
+        double best = 1e30;
+        int identical = 1;
+        for (int rep = 0; rep < repetitions; rep++)
+        {
+            double start = bench_now();
+            QTNode *root = create_quadtree_parallel(image, max_rmse, thread_counts[t], 0);
+            double elapsed = bench_now() - start;
+            if (elapsed < best) best = elapsed;
+            if (!bench_trees_equal(reference, root)) identical = 0;
+            delete_quadtree(root);
+        }
+        if (t == 0) serial_time = best;
+        printf("%9d %12.3f %8.2fx %s\n", thread_counts[t], best * 1e3, serial_time / best, identical ? "yes" : "NO");
+        if (!identical) failures++;
+    }
+    delete_quadtree(reference);
+    return failures;
+}
+
+// Scaling of create_quadtree_parallel on einstein2.ppm and a large synthetic image.
+// Run from the repository root: ./build/parallel_bench [repetitions] [synthetic side]
+int main(int argc, char **argv)
+{
+    int repetitions = argc > 1 ? atoi(argv[1]) : 3;
+    unsigned int side = (unsigned int)(argc > 2 ? atoi(argv[2]) : 4096);
+
+    int failures = 0;
+    Image *image = load_image("images/originals/einstein2.ppm");
+    if (image)
+    {
+        failures += run_scaling("einstein2.ppm", image, 5, repetitions);
+        delete_image(image);
+    }
+
+    image = bench_synthetic_image(side, side, BENCH_IMAGE_TEXTURED);
+    if (image)
+    {
+        failures += run_scaling("synthetic textured", image, 10, repetitions);
+        delete_image(image);
+    }
+    return failures ? 1 : 0;
+}
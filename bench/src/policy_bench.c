@@ -0,0 +1,170 @@
+#include <math.h>
+#include <string.h>
+
+#include "qtree.h"
+#include "image.h"
+#include "qtree_policy.h"
+
+#include "bench_utils.h"
+
+typedef struct TreeShape
+{
+    unsigned long long nodes;
+    unsigned long long leaves;
+    int depth;
+    int min_leaf_side;
+} TreeShape;
+
+static void measure_tree(QTNode *node, int depth, TreeShape *shape)
+{
+    if (!node) return;
+    shape->nodes++;
+    if (depth > shape->depth) shape->depth = depth;
+    if (node->is_leaf)
+    {
+        int side = node->width > node->height ? node->width : node->height;
+        if (shape->leaves++ == 0 || side < shape->min_leaf_side) shape->min_leaf_side = side;
+        return;
+    }
+    for (int i = 0; i < 4; i++) measure_tree(node->children[i], depth + 1, shape);
+}
+
+static double tree_psnr(Image *image, QTNode *root)
+{
+    unsigned char *pixels = render_quadtree(root);
+    if (!pixels) return 0;
+    unsigned long long squared_error = 0;
+    size_t count = (size_t)image->width * image->height;
+    for (size_t i = 0; i < count; i++)
+    {
+        long long diff = (long long)image->data[i] - pixels[i];
+        squared_error += (unsigned long long)(diff * diff);
+    }
+    free(pixels);
+    return squared_error ? 10 * log10(255.0 * 255.0 * (double)count / (double)squared_error) : (double)INFINITY;
+}
+
+// The max-deviation rule with a full scan of every region, to check the early exit.
+static QTNode *reference_deviation_tree(Image *image, QTRegion region, double threshold)
+{
+    QTNode *node = (QTNode *)malloc(sizeof(QTNode));
+    if (!node) return NULL;
+    unsigned long long sum = 0;
+    for (int row = region.row; row < region.row + region.height; row++)
+    {
+        for (int col = region.col; col < region.col + region.width; col++) sum += image->data[(size_t)row * image->width + col];
+    }
+    node->intensity = (unsigned char)(sum / ((unsigned long long)region.width * region.height));
+    int deviation = 0;
+    for (int row = region.row; row < region.row + region.height; row++)
+    {
+        for (int col = region.col; col < region.col + region.width; col++)
+        {
+            int diff = abs((int)image->data[(size_t)row * image->width + col] - node->intensity);
+            if (diff > deviation) deviation = diff;
+        }
+    }
+    node->width = region.width;
+    node->height = region.height;
+    node->is_leaf = deviation <= threshold || (region.width <= 1 && region.height <= 1);
+    QTRegion children[4];
+    split_qt_region(region, children);
+    for (int i = 0; i < 4; i++)
+    {
+        node->children[i] = !node->is_leaf && children[i].width > 0 ? reference_deviation_tree(image, children[i], threshold) : NULL;
+    }
+    return node;
+}
+
+// Builds one tree under `policy`, checks it against `expected` (if given) and against the
+// policy's limits, and prints its size, build time and PSNR.
+static int run_policy(const char *image_label, const char *policy_label, Image *image, QTSplitPolicy *policy, QTNode *expected)
+{
+    double start = bench_now();
+    QTNode *root = create_quadtree_policy(image, policy);
+    double elapsed = bench_now() - start;
+    TreeShape shape = {0, 0, 0, 0};
+    measure_tree(root, 0, &shape);
+
+    int ok = root != NULL && (!expected || bench_trees_equal(root, expected));
+    if (policy->node_budget > 0 && shape.nodes > policy->node_budget) ok = 0;
+    if (policy->max_depth > 0 && shape.depth > policy->max_depth) ok = 0;
+    if (policy->min_block_size > 1 && shape.min_leaf_side * 2 < policy->min_block_size) ok = 0;
+
+    printf("%-16s %-26s %10llu %10llu %6d %10.3f %9.2f %s\n", image_label, policy_label, shape.nodes, shape.leaves, shape.depth,
+           elapsed * 1e3, tree_psnr(image, root), ok ? "yes" : "NO");
+    delete_quadtree(root);
+    return ok ? 0 : 1;
+}
+
+// Compares split policies on one image. The unlimited RMSE policy, depth-first and with a
+// budget above the full tree's size, must reproduce create_quadtree; the deviation rule
+// must match a full-scan reference.
+static int run_image(const char *label, Image *image, double max_rmse, double max_deviation)
+{
+    int failures = 0;
+    char policy_label[64];
+    double start = bench_now();
+    QTNode *reference = create_quadtree(image, max_rmse);
+    double elapsed = bench_now() - start;
+    TreeShape full = {0, 0, 0, 0};
+    measure_tree(reference, 0, &full);
+    snprintf(policy_label, sizeof(policy_label), "create_quadtree rmse %g", max_rmse);
+    printf("%-16s %-26s %10llu %10llu %6d %10.3f %9.2f\n", label, policy_label, full.nodes, full.leaves, full.depth, elapsed * 1e3,
+           tree_psnr(image, reference));
+
+    QTSplitPolicy policy;
+    init_qt_split_policy(&policy, QT_SPLIT_RMSE, max_rmse);
+    failures += run_policy(label, "rmse", image, &policy, reference);
+    policy.node_budget = (unsigned int)full.nodes;
+    failures += run_policy(label, "rmse, budget = full", image, &policy, reference);
+    unsigned int budgets[] = {(unsigned int)(full.nodes / 4), (unsigned int)(full.nodes / 16), 1000};
+    for (size_t i = 0; i < sizeof(budgets) / sizeof(budgets[0]); i++)
+    {
+        policy.node_budget = budgets[i];
+        snprintf(policy_label, sizeof(policy_label), "rmse, budget %u", budgets[i]);
+        failures += run_policy(label, policy_label, image, &policy, NULL);
+    }
+    policy.node_budget = 0;
+    policy.min_block_size = 4;
+    failures += run_policy(label, "rmse, min block 4", image, &policy, NULL);
+    policy.min_block_size = 0;
+    policy.max_depth = 6;
+    failures += run_policy(label, "rmse, max depth 6", image, &policy, NULL);
+    delete_quadtree(reference);
+
+    init_qt_split_policy(&policy, QT_SPLIT_MAX_DEVIATION, max_deviation);
+    QTRegion region = {0, 0, (int)image->width, (int)image->height};
+    QTNode *deviation_reference = reference_deviation_tree(image, region, max_deviation);
+    snprintf(policy_label, sizeof(policy_label), "max deviation %g", max_deviation);
+    failures += run_policy(label, policy_label, image, &policy, deviation_reference);
+    delete_quadtree(deviation_reference);
+    policy.node_budget = (unsigned int)(full.nodes / 4);
+    snprintf(policy_label, sizeof(policy_label), "max deviation, budget %u", policy.node_budget);
+    failures += run_policy(label, policy_label, image, &policy, NULL);
+    printf("\n");
+    return failures;
+}
+
+// Run from the repository root: ./build/policy_bench [synthetic side]
+int main(int argc, char **argv)
+{
+    unsigned int side = (unsigned int)(argc > 1 ? atoi(argv[1]) : 1024);
+    printf("%-16s %-26s %10s %10s %6s %10s %9s %s\n", "image", "policy", "nodes", "leaves", "depth", "build(ms)", "PSNR(dB)", "checked");
+    int failures = 0;
+    Image *image = load_image("images/originals/einstein2.ppm");
+    if (image)
+    {
+        failures += run_image("einstein2", image, 10, 24);
+        delete_image(image);
+    }
+    BenchImageKind kinds[] = {BENCH_IMAGE_NOISE, BENCH_IMAGE_TEXTURED};
+    for (size_t k = 0; k < sizeof(kinds) / sizeof(kinds[0]); k++)
+    {
+        image = bench_synthetic_image(side, side, kinds[k]);
+        if (!image) continue;
+        failures += run_image(bench_image_kind_name(kinds[k]), image, 10, 24);
+        delete_image(image);
+    }
+    return failures ? 1 : 0;
+}
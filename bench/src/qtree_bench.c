@@ -0,0 +1,388 @@
+#include <dirent.h>
+#include <math.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "qtree.h"
+#include "image.h"
+#include "qtree_stats.h"
+
+#include "bench_utils.h"
+
+#define QTREE_BENCH_MAX_REPETITIONS 1000
+#define QTREE_BENCH_REFERENCE_RMSE 10.0
+
+// Everything one benchmarked image needs: the source file, the decoded image, a tree built
+// at the reference threshold and the scratch files the save/hide functions write.
+typedef struct QTBenchInput
+{
+    char name[256];
+    char path[512];
+    Image *image;
+    QTNode *tree;
+    QTNode *scratch_tree;
+    char *message;
+    char *text_file;
+    char *ppm_file;
+    char *stego_file;
+    char *secret_file;
+    char *revealed_file;
+} QTBenchInput;
+
+// One timed public function. `setup` runs untimed before each sample, `run` is timed.
+typedef struct QTBenchOp
+{
+    const char *function;
+    double max_rmse; // create_quadtree threshold, or -1 when the function takes none
+    void (*setup)(QTBenchInput *input, double max_rmse);
+    void (*run)(QTBenchInput *input, double max_rmse);
+} QTBenchOp;
+
+typedef struct QTBenchStats
+{
+    double min, median, p90, p99, max, mean;
+} QTBenchStats;
+
+static void run_load_image(QTBenchInput *input, double max_rmse)
+{
+    (void)max_rmse;
+    delete_image(load_image(input->path));
+}
+
+// Frees the previous sample's tree outside the timed call.
+static void setup_create_quadtree(QTBenchInput *input, double max_rmse)
+{
+    (void)max_rmse;
+    delete_quadtree(input->scratch_tree);
+    input->scratch_tree = NULL;
+}
+
+static void run_create_quadtree(QTBenchInput *input, double max_rmse)
+{
+    input->scratch_tree = create_quadtree(input->image, max_rmse);
+}
+
+static void run_save_preorder_qt(QTBenchInput *input, double max_rmse)
+{
+    (void)max_rmse;
+    save_preorder_qt(input->tree, input->text_file);
+}
+
+static void run_load_preorder_qt(QTBenchInput *input, double max_rmse)
+{
+    (void)max_rmse;
+    delete_quadtree(load_preorder_qt(input->text_file));
+}
+
+static void run_save_qtree_as_ppm(QTBenchInput *input, double max_rmse)
+{
+    (void)max_rmse;
+    save_qtree_as_ppm(input->tree, input->ppm_file);
+}
+
+static void setup_delete_quadtree(QTBenchInput *input, double max_rmse)
+{
+    (void)max_rmse;
+    delete_quadtree(input->scratch_tree);
+    input->scratch_tree = create_quadtree(input->image, QTREE_BENCH_REFERENCE_RMSE);
+}
+
+static void run_delete_quadtree(QTBenchInput *input, double max_rmse)
+{
+    (void)max_rmse;
+    delete_quadtree(input->scratch_tree);
+    input->scratch_tree = NULL;
+}
+
+static void run_hide_message(QTBenchInput *input, double max_rmse)
+{
+    (void)max_rmse;
+    hide_message(input->message, input->path, input->stego_file);
+}
+
+static void run_reveal_message(QTBenchInput *input, double max_rmse)
+{
+    (void)max_rmse;
+    free(reveal_message(input->stego_file));
+}
+
+static void run_hide_image(QTBenchInput *input, double max_rmse)
+{
+    (void)max_rmse;
+    hide_image(input->secret_file, input->path, input->stego_file);
+}
+
+static void run_reveal_image(QTBenchInput *input, double max_rmse)
+{
+    (void)max_rmse;
+    reveal_image(input->stego_file, input->revealed_file);
+}
+
+// The reveal functions read what the matching hide function wrote.
+static void setup_reveal_message(QTBenchInput *input, double max_rmse)
+{
+    (void)max_rmse;
+    hide_message(input->message, input->path, input->stego_file);
+}
+
+static void setup_reveal_image(QTBenchInput *input, double max_rmse)
+{
+    (void)max_rmse;
+    hide_image(input->secret_file, input->path, input->stego_file);
+}
+
+static const QTBenchOp qtree_bench_ops[] = {
+    {"load_image", -1, NULL, run_load_image},
+    {"create_quadtree", 0, setup_create_quadtree, run_create_quadtree},
+    {"create_quadtree", QTREE_BENCH_REFERENCE_RMSE, setup_create_quadtree, run_create_quadtree},
+    {"create_quadtree", 40, setup_create_quadtree, run_create_quadtree},
+    {"save_preorder_qt", -1, NULL, run_save_preorder_qt},
+    {"load_preorder_qt", -1, NULL, run_load_preorder_qt},
+    {"save_qtree_as_ppm", -1, NULL, run_save_qtree_as_ppm},
+    {"delete_quadtree", -1, setup_delete_quadtree, run_delete_quadtree},
+    {"hide_message", -1, NULL, run_hide_message},
+    {"reveal_message", -1, setup_reveal_message, run_reveal_message},
+    {"hide_image", -1, NULL, run_hide_image},
+    {"reveal_image", -1, setup_reveal_image, run_reveal_image},
+};
+
+static int compare_doubles(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// Nearest-rank percentile of sorted samples.
+static double percentile(double *sorted, int count, double fraction)
+{
+    int rank = (int)ceil(fraction * count);
+    if (rank < 1) rank = 1;
+    return sorted[rank - 1];
+}
+
+static QTBenchStats summarize(double *samples, int count)
+{
+    qsort(samples, (size_t)count, sizeof(double), compare_doubles);
+    QTBenchStats stats;
+    double total = 0;
+    for (int i = 0; i < count; i++) total += samples[i];
+    stats.min = samples[0];
+    stats.median = percentile(samples, count, 0.5);
+    stats.p90 = percentile(samples, count, 0.9);
+    stats.p99 = percentile(samples, count, 0.99);
+    stats.max = samples[count - 1];
+    stats.mean = total / count;
+    return stats;
+}
+
+// A secret for hide_image: the largest square (up to the 255 its 8-bit header can store)
+// that fits in the carrier, cut from the carrier itself.
+static int write_secret(QTBenchInput *input)
+{
+    unsigned long pixels = (unsigned long)input->image->width * input->image->height;
+    unsigned int side = pixels > 16 ? (unsigned int)sqrt((double)(pixels - 16) / 8) : 0;
+    if (side > 255) side = 255;
+    if (side > input->image->width) side = input->image->width;
+    if (side > input->image->height) side = input->image->height;
+    if (side == 0) return 0;
+    Image *secret = create_image(side, side, 1);
+    if (!secret) return 0;
+    for (unsigned int row = 0; row < side; row++)
+    {
+        memcpy(&secret->data[(size_t)row * side], &input->image->data[(size_t)row * input->image->width], side);
+    }
+    int saved = save_image(secret, input->secret_file, IMAGE_FORMAT_P3);
+    delete_image(secret);
+    return saved;
+}
+
+// A message filling half the carrier's hide_message capacity.
+static char *make_message(Image *image)
+{
+    size_t length = (size_t)image->width * image->height / 16;
+    char *message = (char *)malloc(length + 1);
+    if (!message) return NULL;
+    for (size_t i = 0; i < length; i++) message[i] = (char)('a' + i % 26);
+    message[length] = '\0';
+    return message;
+}
+
+static void write_json_string(FILE *json, const char *text)
+{
+    fputc('"', json);
+    for (; *text; text++)
+    {
+        if (*text == '"' || *text == '\\') fputc('\\', json);
+        if ((unsigned char)*text >= 0x20) fputc(*text, json);
+    }
+    fputc('"', json);
+}
+
+// Times every operation on one input and appends a JSON record per operation.
+static int run_input(QTBenchInput *input, int warmup, int repetitions, FILE *json, int *first_record)
+{
+    input->tree = create_quadtree(input->image, QTREE_BENCH_REFERENCE_RMSE);
+    input->message = make_message(input->image);
+    int has_secret = write_secret(input);
+    int failed = !input->tree || !input->message;
+    if (!failed) save_preorder_qt(input->tree, input->text_file);
+
+    double samples[QTREE_BENCH_MAX_REPETITIONS];
+    for (size_t op = 0; !failed && op < sizeof(qtree_bench_ops) / sizeof(qtree_bench_ops[0]); op++)
+    {
+        const QTBenchOp *bench_op = &qtree_bench_ops[op];
+        if (!has_secret && (bench_op->run == run_hide_image || bench_op->run == run_reveal_image)) continue;
+        for (int i = 0; i < warmup + repetitions; i++)
+        {
+            if (bench_op->setup) bench_op->setup(input, bench_op->max_rmse);
+            double start = bench_now();
+            bench_op->run(input, bench_op->max_rmse);
+            double elapsed = bench_now() - start;
+            if (i >= warmup) samples[i - warmup] = elapsed * 1e3;
+        }
+        QTBenchStats stats = summarize(samples, repetitions);
+
+        char label[64];
+        if (bench_op->max_rmse >= 0) snprintf(label, sizeof(label), "%s(%g)", bench_op->function, bench_op->max_rmse);
+        else snprintf(label, sizeof(label), "%s", bench_op->function);
+        printf("%-20s %-22s %10.3f %10.3f %10.3f %10.3f %10.3f\n", input->name, label, stats.min, stats.median, stats.p90, stats.p99, stats.mean);
+
+        fprintf(json, "%s\n    {\"image\": ", *first_record ? "" : ",");
+        write_json_string(json, input->name);
+        fprintf(json, ", \"width\": %u, \"height\": %u, \"function\": ", input->image->width, input->image->height);
+        write_json_string(json, bench_op->function);
+        if (bench_op->max_rmse >= 0) fprintf(json, ", \"max_rmse\": %g", bench_op->max_rmse);
+        fprintf(json, ", \"samples\": %d, \"min_ms\": %.6f, \"median_ms\": %.6f, \"p90_ms\": %.6f, \"p99_ms\": %.6f, \"max_ms\": %.6f, \"mean_ms\": %.6f}",
+                repetitions, stats.min, stats.median, stats.p90, stats.p99, stats.max, stats.mean);
+        *first_record = 0;
+    }
+
+    delete_quadtree(input->tree);
+    delete_quadtree(input->scratch_tree);
+    free(input->message);
+    input->tree = input->scratch_tree = NULL;
+    input->message = NULL;
+    return failed;
+}
+
+// With instrumentation compiled in, appends what qtree_stats gathered while one input ran.
+static void write_input_stats(FILE *stats_json, const char *name, int first)
+{
+    if (!stats_json) return;
+    QTStats stats;
+    get_qt_stats(&stats);
+    fprintf(stats_json, "%s\n", first ? "" : ",");
+    write_json_string(stats_json, name);
+    fprintf(stats_json, ": ");
+    write_qt_stats_json(&stats, stats_json);
+}
+
+static void init_input(QTBenchInput *input, const char *name, const char *path)
+{
+    memset(input, 0, sizeof(*input));
+    snprintf(input->name, sizeof(input->name), "%s", name);
+    snprintf(input->path, sizeof(input->path), "%s", path);
+    input->text_file = "tests/output/qtree_bench_tree.txt";
+    input->ppm_file = "tests/output/qtree_bench_tree.ppm";
+    input->stego_file = "tests/output/qtree_bench_stego.ppm";
+    input->secret_file = "tests/output/qtree_bench_secret.ppm";
+    input->revealed_file = "tests/output/qtree_bench_revealed.ppm";
+}
+
+// Times the public image.h and qtree.h functions over every image in a directory and over
+// large synthetic images, reporting min/median/p90/p99/mean per function in ms and writing
+// the same records as JSON for tracking across commits. A build configured with
+// QTREE_ENABLE_STATS also writes each input's qtree_stats to <json file>.stats.json.
+// Run from the repository root:
+// ./build/qtree_bench [repetitions] [warmup] [json file] [directory] [synthetic side]
+int main(int argc, char **argv)
+{
+    int repetitions = argc > 1 ? atoi(argv[1]) : 5;
+    int warmup = argc > 2 ? atoi(argv[2]) : 1;
+    char *json_file = argc > 3 ? argv[3] : "tests/output/qtree_bench.json";
+    char *directory = argc > 4 ? argv[4] : "images/originals";
+    unsigned int side = (unsigned int)(argc > 5 ? atoi(argv[5]) : 2048);
+    if (repetitions < 1 || repetitions > QTREE_BENCH_MAX_REPETITIONS || warmup < 0)
+    {
+        ERROR("Repetitions must be 1 to %d and warmup non-negative", QTREE_BENCH_MAX_REPETITIONS);
+        return 1;
+    }
+    mkdir("tests/output", 0700);
+
+    FILE *json = fopen(json_file, "w");
+    if (!json)
+    {
+        ERROR("Failed to open %s", json_file);
+        return 1;
+    }
+    fprintf(json, "{\n  \"repetitions\": %d,\n  \"warmup\": %d,\n  \"results\": [", repetitions, warmup);
+    char stats_file[512];
+    snprintf(stats_file, sizeof(stats_file), "%s.stats.json", json_file);
+    FILE *stats_json = qt_stats_enabled() ? fopen(stats_file, "w") : NULL;
+    if (stats_json) fprintf(stats_json, "{");
+
+    printf("%-20s %-22s %10s %10s %10s %10s %10s\n", "image", "function", "min(ms)", "median", "p90", "p99", "mean");
+    int failures = 0, first_record = 1, inputs = 0;
+    QTBenchInput input;
+
+    DIR *dir = opendir(directory);
+    if (!dir)
+    {
+        ERROR("Failed to open directory %s", directory);
+        failures++;
+    }
+    struct dirent *entry;
+    while (dir && (entry = readdir(dir)) != NULL)
+    {
+        size_t name_length = strlen(entry->d_name);
+        if (name_length < 4 || strcmp(entry->d_name + name_length - 4, ".ppm") != 0) continue;
+        char path[512];
+        snprintf(path, sizeof(path), "%s/%s", directory, entry->d_name);
+        init_input(&input, entry->d_name, path);
+        input.image = load_image(path);
+        if (!input.image)
+        {
+            ERROR("Failed to load %s", path);
+            failures++;
+            continue;
+        }
+        reset_qt_stats();
+        failures += run_input(&input, warmup, repetitions, json, &first_record);
+        write_input_stats(stats_json, input.name, inputs++ == 0);
+        delete_image(input.image);
+    }
+    if (dir) closedir(dir);
+
+    BenchImageKind kinds[] = {BENCH_IMAGE_NOISE, BENCH_IMAGE_GRADIENT, BENCH_IMAGE_FLAT};
+    for (size_t k = 0; k < sizeof(kinds) / sizeof(kinds[0]); k++)
+    {
+        char name[64];
+        snprintf(name, sizeof(name), "%s %ux%u", bench_image_kind_name(kinds[k]), side, side);
+        init_input(&input, name, "tests/output/qtree_bench_synthetic.ppm");
+        input.image = bench_synthetic_image(side, side, kinds[k]);
+        if (!input.image || !save_image(input.image, input.path, IMAGE_FORMAT_P6))
+        {
+            delete_image(input.image);
+            failures++;
+            continue;
+        }
+        reset_qt_stats();
+        failures += run_input(&input, warmup, repetitions, json, &first_record);
+        write_input_stats(stats_json, input.name, inputs++ == 0);
+        delete_image(input.image);
+        remove(input.path);
+    }
+
+    fprintf(json, "\n  ]\n}\n");
+    fclose(json);
+    if (stats_json)
+    {
+        fprintf(stats_json, "\n}\n");
+        fclose(stats_json);
+        printf("Wrote %s\n", stats_file);
+    }
+    char *scratch[] = {input.text_file, input.ppm_file, input.stego_file, input.secret_file, input.revealed_file};
+    for (size_t i = 0; i < sizeof(scratch) / sizeof(scratch[0]); i++) remove(scratch[i]);
+    printf("\nWrote %s\n", json_file);
+    return failures ? 1 : 0;
+}
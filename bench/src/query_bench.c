@@ -0,0 +1,134 @@
+#include "qtree.h"
+#include "image.h"
+#include "qtree_query.h"
+
+#include "bench_utils.h"
+
+static unsigned int next_random(unsigned int *state)
+{
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+    return *state;
+}
+
+// Brute-force statistics over the rendered raster, the reference for query_qt_region.
+static int region_matches_render(QTNode *root, unsigned char *pixels, QTRegion query)
+{
+    QTRegionStats stats;
+    if (!query_qt_region(root, query, &stats, NULL)) return 0;
+    unsigned long long sum = 0, count = 0;
+    unsigned char min = 255, max = 0;
+    for (int row = query.row; row < query.row + query.height && row < root->height; row++)
+    {
+        for (int col = query.col; col < query.col + query.width && col < root->width; col++)
+        {
+            unsigned char value = pixels[(size_t)row * root->width + col];
+            sum += value;
+            count++;
+            if (value < min) min = value;
+            if (value > max) max = value;
+        }
+    }
+    if (count != stats.pixel_count) return 0;
+    return count == 0 || (stats.min == min && stats.max == max && stats.mean == (double)sum / (double)count);
+}
+
+static int run_case(char *label, QTNode *root, int point_count, int repetitions)
+{
+    unsigned char *pixels = render_quadtree(root);
+    int *rows = (int *)malloc((size_t)point_count * sizeof(int));
+    int *cols = (int *)malloc((size_t)point_count * sizeof(int));
+    unsigned char *single = (unsigned char *)malloc((size_t)point_count);
+    unsigned char *batched = (unsigned char *)malloc((size_t)point_count);
+    if (!pixels || !rows || !cols || !single || !batched)
+    {
+        free(pixels);
+        free(rows);
+        free(cols);
+        free(single);
+        free(batched);
+        return 1;
+    }
+
+    int identical = 1;
+    for (int row = 0; identical && row < root->height; row++)
+    {
+        for (int col = 0; col < root->width; col++)
+        {
+            if (query_qt_point(root, row, col) != pixels[(size_t)row * root->width + col]) identical = 0;
+        }
+    }
+    unsigned int state = 2463534242u;
+    for (int i = 0; identical && i < 200; i++)
+    {
+        QTRegion query = {(int)(next_random(&state) % (unsigned int)root->height), (int)(next_random(&state) % (unsigned int)root->width),
+                          (int)(next_random(&state) % 300) + 1, (int)(next_random(&state) % 300) + 1};
+        identical = region_matches_render(root, pixels, query);
+    }
+
+    for (int i = 0; i < point_count; i++)
+    {
+        rows[i] = (int)(next_random(&state) % (unsigned int)root->height);
+        cols[i] = (int)(next_random(&state) % (unsigned int)root->width);
+    }
+    double single_time = 1e30, batched_time = 1e30, region_time = 1e30;
+    for (int rep = 0; rep < repetitions; rep++)
+    {
+        double start = bench_now();
+        for (int i = 0; i < point_count; i++) single[i] = query_qt_point(root, rows[i], cols[i]);
+        double middle = bench_now();
+        query_qt_points(root, rows, cols, (size_t)point_count, batched);
+        double end = bench_now();
+        QTRegionStats stats;
+        QTRegion tile = {root->height / 4, root->width / 4, 256, 256};
+        query_qt_region(root, tile, &stats, NULL);
+        double region_end = bench_now();
+        if (middle - start < single_time) single_time = middle - start;
+        if (end - middle < batched_time) batched_time = end - middle;
+        if (region_end - end < region_time) region_time = region_end - end;
+    }
+    for (int i = 0; i < point_count; i++)
+    {
+        if (single[i] != batched[i]) identical = 0;
+    }
+    printf("%-24s %12.1f %12.1f %12.3f %s\n", label, single_time * 1e9 / point_count, batched_time * 1e9 / point_count,
+           region_time * 1e6, identical ? "yes" : "NO");
+
+    free(pixels);
+    free(rows);
+    free(cols);
+    free(single);
+    free(batched);
+    return identical ? 0 : 1;
+}
+
+// Checks point and region queries against render_quadtree and times single, batched
+// (Morton-sorted) and 256x256 region lookups.
+// Run from the repository root: ./build/query_bench [points] [repetitions]
+int main(int argc, char **argv)
+{
+    int point_count = argc > 1 ? atoi(argv[1]) : 100000;
+    int repetitions = argc > 2 ? atoi(argv[2]) : 5;
+
+    printf("%-24s %12s %12s %12s %s\n", "tree", "ns/point", "ns/batched", "region us", "identical");
+    int failures = 0;
+    Image *image = load_image("images/originals/einstein2.ppm");
+    if (image)
+    {
+        QTNode *root = create_quadtree(image, 5);
+        failures += run_case("einstein2 rmse 5", root, point_count, repetitions);
+        delete_quadtree(root);
+        delete_image(image);
+    }
+
+    image = bench_synthetic_image(4096, 4096, BENCH_IMAGE_TEXTURED);
+    if (image)
+    {
+        QTNode *root = create_quadtree(image, 10);
+        failures += run_case("textured 4096 rmse 10", root, point_count, repetitions);
+        delete_quadtree(root);
+        delete_image(image);
+    }
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,56 @@
+#include "qtree.h"
+#include "image.h"
+
+#include "bench_utils.h"
+
+// Compares the recursive scan builder against the summed-area-table builder.
+// Run from the repository root: ./build/sat_bench [image.ppm] [repetitions]
+int main(int argc, char **argv)
+{
+    char *filename = argc > 1 ? argv[1] : "images/originals/einstein2.ppm";
+    int repetitions = argc > 2 ? atoi(argv[2]) : 5;
+    double thresholds[] = {0, 5, 10, 25, 50};
+
+    Image *image = load_image(filename);
+    if (!image)
+    {
+        ERROR("Failed to load %s", filename);
+        return 1;
+    }
+    printf("%s: %ux%u, %d repetitions\n", filename, image->width, image->height, repetitions);
+    printf("%10s %14s %14s %9s %s\n", "max_rmse", "recursive(ms)", "sat(ms)", "speedup", "identical");
+
+    int failures = 0;
+    for (size_t t = 0; t < sizeof(thresholds) / sizeof(thresholds[0]); t++)
+    {
+        double recursive_best = 1e30, sat_best = 1e30;
+        int identical = 1;
+        for (int rep = 0; rep < repetitions; rep++)
+        {
+            double start = bench_now();
+            QTNode *recursive_root = create_quadtree(image, thresholds[t]);
+            double middle = bench_now();
+            QTNode *sat_root = create_quadtree_sat(image, thresholds[t]);
+            double end = bench_now();
+
+            if (middle - start < recursive_best) recursive_best = middle - start;
+            if (end - middle < sat_best) sat_best = end - middle;
+
+            if (rep == 0)
+            {
+                save_preorder_qt(recursive_root, "bench_recursive_qtree.txt");
+                save_preorder_qt(sat_root, "bench_sat_qtree.txt");
+                identical = bench_files_equal("bench_recursive_qtree.txt", "bench_sat_qtree.txt");
+            }
+            delete_quadtree(recursive_root);
+            delete_quadtree(sat_root);
+        }
+        printf("%10.1f %14.3f %14.3f %8.2fx %s\n", thresholds[t], recursive_best * 1e3, sat_best * 1e3,
+               recursive_best / sat_best, identical ? "yes" : "NO");
+        if (!identical) failures++;
+    }
+    remove("bench_recursive_qtree.txt");
+    remove("bench_sat_qtree.txt");
+    delete_image(image);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,236 @@
+#include <string.h>
+#include <sys/stat.h>
+
+#include "image.h"
+#include "stego_packed.h"
+
+#include "bench_utils.h"
+
+// The per-pixel embedding hide_message performed before the word-wide rewrite.
+static void reference_hide_message(Image *image, char *message)
+{
+    size_t msg_len = strlen(message);
+    size_t available_space = (size_t)image->width * image->height;
+    size_t pixel = 0;
+    for (size_t msg_idx = 0; available_space >= 8 && msg_idx <= msg_len; msg_idx++)
+    {
+        unsigned char current_char = (unsigned char)(available_space > 8 ? message[msg_idx] : '\0');
+        for (int bit_pos = 7; bit_pos >= 0; bit_pos--)
+        {
+            unsigned char *sample = &image->data[pixel++];
+            *sample = (unsigned char)((*sample & ~1) | ((current_char >> bit_pos) & 1));
+        }
+        available_space -= 8;
+    }
+}
+
+// Hides a message in `frames` copies of a carrier and reveals it again, checking each output
+// file against the reference embedding and each revealed message against the original.
+static int run_case(char *label, char *carrier, char *message, ImageFormat format, int frames)
+{
+    char *output = "tests/output/stego_bench.ppm";
+    char *reference_output = "tests/output/stego_bench_reference.ppm";
+    Image *reference = load_image(carrier);
+    if (!reference) return 1;
+    reference_hide_message(reference, message);
+    int identical = save_image(reference, reference_output, format);
+    size_t expected_length = strlen(message) < (size_t)reference->width * reference->height / 8 ? strlen(message) : 0;
+    delete_image(reference);
+
+    double hide_time = 0, reveal_time = 0;
+    for (int frame = 0; frame < frames; frame++)
+    {
+        double start = bench_now();
+        hide_message_format(message, carrier, output, format);
+        double hidden = bench_now();
+        char *revealed = reveal_message(output);
+        double end = bench_now();
+        hide_time += hidden - start;
+        reveal_time += end - hidden;
+        if (!revealed || !bench_files_equal(output, reference_output) || (expected_length && strcmp(revealed, message) != 0)) identical = 0;
+        free(revealed);
+    }
+    printf("%-28s %10zu %12.3f %12.3f %s\n", label, strlen(message), hide_time * 1e3 / frames, reveal_time * 1e3 / frames, identical ? "yes" : "NO");
+    remove(output);
+    remove(reference_output);
+    return identical ? 0 : 1;
+}
+
+// An RGB carrier whose channels differ, built from a synthetic grayscale image.
+static Image *make_rgb_carrier(unsigned int width, unsigned int height)
+{
+    Image *gray = bench_synthetic_image(width, height, BENCH_IMAGE_TEXTURED);
+    Image *carrier = gray ? create_image(width, height, 3) : NULL;
+    if (carrier)
+    {
+        for (size_t i = 0; i < (size_t)width * height; i++)
+        {
+            carrier->data[3 * i] = gray->data[i];
+            carrier->data[3 * i + 1] = (unsigned char)(gray->data[i] ^ 0x55);
+            carrier->data[3 * i + 2] = (unsigned char)(gray->data[i] + i);
+        }
+    }
+    delete_image(gray);
+    return carrier;
+}
+
+// Embeds the largest secret that fits at `packing` (at least 256 wide, which the 8-bit
+// hide_image header cannot store) and checks the round trip and that only the payload's
+// low bits changed.
+static int run_packed_case(Image *carrier, StegoPacking packing, int frames)
+{
+    unsigned long long capacity = get_stego_capacity(carrier->width, carrier->height, packing);
+    unsigned int width = 512;
+    unsigned int height = (unsigned int)(capacity / width);
+    Image *secret = bench_synthetic_image(width, height, BENCH_IMAGE_NOISE);
+    Image *work = create_image(carrier->width, carrier->height, 3);
+    if (!secret || !work)
+    {
+        delete_image(secret);
+        delete_image(work);
+        return 1;
+    }
+
+    size_t carrier_bytes = (size_t)carrier->width * carrier->height * 3;
+    double embed_time = 0, extract_time = 0;
+    int identical = 1;
+    for (int frame = 0; frame < frames; frame++)
+    {
+        memcpy(work->data, carrier->data, carrier_bytes);
+        double start = bench_now();
+        if (!embed_packed_image(work, secret, packing)) identical = 0;
+        double embedded = bench_now();
+        Image *revealed = extract_packed_image(work);
+        double end = bench_now();
+        embed_time += embedded - start;
+        extract_time += end - embedded;
+        if (!revealed || memcmp(revealed->data, secret->data, (size_t)width * height) != 0) identical = 0;
+        delete_image(revealed);
+    }
+
+    unsigned char payload_mask = (unsigned char)((1u << packing.bits_per_channel) - 1);
+    for (size_t i = 0; i < carrier_bytes; i++)
+    {
+        int channel = (int)(i % 3);
+        unsigned char allowed = i < 3 * STEGO_HEADER_PIXELS ? (channel == 0) : (channel == 0 || packing.channels == 3) ? payload_mask : 0;
+        if ((work->data[i] ^ carrier->data[i]) & ~allowed) identical = 0;
+    }
+
+    double megabytes = (double)width * height / 1e6;
+    printf("%d bit(s) x %-3s %7ux%-7u %10.1f %12.1f %12.1f %s\n", packing.bits_per_channel, packing.channels == 3 ? "RGB" : "R", width, height,
+           (double)width * height / ((double)carrier->width * carrier->height / 8), megabytes * frames / embed_time,
+           megabytes * frames / extract_time, identical ? "yes" : "NO");
+    delete_image(secret);
+    delete_image(work);
+    return identical ? 0 : 1;
+}
+
+// Embeds and extracts a capacity-filling secret in a large carrier on 1 to 8 threads, in
+// memory and through hide/reveal_image_packed_parallel, whose files must match the
+// single-threaded hide_image_packed (P6) and reveal_image_packed (P5) outputs.
+static int run_parallel_cases(unsigned int side, int frames)
+{
+    char *carrier_file = "tests/output/stego_bench_large.ppm";
+    char *secret_file = "tests/output/stego_bench_secret.pgm";
+    char *serial_hidden = "tests/output/stego_bench_hidden_serial.ppm";
+    char *parallel_hidden = "tests/output/stego_bench_hidden_parallel.ppm";
+    char *serial_revealed = "tests/output/stego_bench_revealed_serial.pgm";
+    char *parallel_revealed = "tests/output/stego_bench_revealed_parallel.pgm";
+    StegoPacking packing = {2, 3};
+
+    Image *carrier = make_rgb_carrier(side, side);
+    unsigned long long capacity = carrier ? get_stego_capacity(side, side, packing) : 0;
+    Image *secret = carrier ? bench_synthetic_image(side, (unsigned int)(capacity / side), BENCH_IMAGE_NOISE) : NULL;
+    Image *work = carrier ? create_image(side, side, 3) : NULL;
+    int failures = !(carrier && secret && work && save_image(carrier, carrier_file, IMAGE_FORMAT_P6) && save_image(secret, secret_file, IMAGE_FORMAT_P5) &&
+                     hide_image_packed(secret_file, carrier_file, serial_hidden, packing, IMAGE_FORMAT_P6) &&
+                     reveal_image_packed(serial_hidden, serial_revealed, IMAGE_FORMAT_P5));
+
+    printf("\n%-24s %8s %12s %12s %12s %12s %s\n", "carrier", "threads", "embed(ms)", "extract(ms)", "hide(ms)", "reveal(ms)", "identical");
+    int threads[] = {1, 2, 4, 8};
+    size_t carrier_bytes = (size_t)side * side * 3;
+    for (size_t t = 0; !failures && t < sizeof(threads) / sizeof(threads[0]); t++)
+    {
+        double embed_time = 0, extract_time = 0, hide_time = 0, reveal_time = 0;
+        int identical = 1;
+        for (int frame = 0; frame < frames; frame++)
+        {
+            memcpy(work->data, carrier->data, carrier_bytes);
+            double start = bench_now();
+            embed_packed_image_parallel(work, secret, packing, threads[t]);
+            double embedded = bench_now();
+            Image *revealed = extract_packed_image_parallel(work, threads[t]);
+            double extracted = bench_now();
+            hide_image_packed_parallel(secret_file, carrier_file, parallel_hidden, packing, threads[t]);
+            double hidden = bench_now();
+            reveal_image_packed_parallel(parallel_hidden, parallel_revealed, threads[t]);
+            double end = bench_now();
+            embed_time += embedded - start;
+            extract_time += extracted - embedded;
+            hide_time += hidden - extracted;
+            reveal_time += end - hidden;
+            if (!revealed || memcmp(revealed->data, secret->data, (size_t)secret->width * secret->height) != 0 ||
+                !bench_files_equal(parallel_hidden, serial_hidden) || !bench_files_equal(parallel_revealed, serial_revealed))
+            {
+                identical = 0;
+            }
+            delete_image(revealed);
+        }
+        char label[32];
+        snprintf(label, sizeof(label), "%ux%u 2 bits x RGB", side, side);
+        printf("%-24s %8d %12.3f %12.3f %12.3f %12.3f %s\n", label, threads[t], embed_time * 1e3 / frames, extract_time * 1e3 / frames,
+               hide_time * 1e3 / frames, reveal_time * 1e3 / frames, identical ? "yes" : "NO");
+        if (!identical) failures++;
+    }
+
+    delete_image(carrier);
+    delete_image(secret);
+    delete_image(work);
+    char *files[] = {carrier_file, secret_file, serial_hidden, parallel_hidden, serial_revealed, parallel_revealed};
+    for (size_t i = 0; i < sizeof(files) / sizeof(files[0]); i++) remove(files[i]);
+    return failures;
+}
+
+// Times hide_message and reveal_message on a watermark-sized and a capacity-filling message,
+// then packed image hiding at each bit depth against hide_image's 1 bit per pixel capacity,
+// then threaded packed hiding on a large carrier.
+// Run from the repository root: ./build/stego_bench [frames] [large carrier side]
+int main(int argc, char **argv)
+{
+    int frames = argc > 1 ? atoi(argv[1]) : 20;
+    mkdir("tests/output", 0700);
+
+    char *carrier = "tests/output/stego_bench_carrier.ppm";
+    Image *image = bench_synthetic_image(1920, 1080, BENCH_IMAGE_TEXTURED);
+    if (!image || !save_image(image, carrier, IMAGE_FORMAT_P6))
+    {
+        delete_image(image);
+        return 1;
+    }
+    size_t capacity = (size_t)image->width * image->height / 8;
+    delete_image(image);
+
+    char watermark[] = "(c) 2024 frame watermark";
+    char *filled = (char *)malloc(capacity);
+    if (!filled) return 1;
+    for (size_t i = 0; i + 1 < capacity; i++) filled[i] = (char)('a' + i % 26);
+    filled[capacity - 1] = '\0';
+
+    printf("%-28s %10s %12s %12s %s\n", "case", "chars", "hide(ms)", "reveal(ms)", "identical");
+    int failures = 0;
+    failures += run_case("1080p P6 watermark", carrier, watermark, IMAGE_FORMAT_P6, frames);
+    failures += run_case("1080p P6 full capacity", carrier, filled, IMAGE_FORMAT_P6, frames);
+    failures += run_case("1080p P3 watermark", carrier, watermark, IMAGE_FORMAT_P3, frames);
+    free(filled);
+    remove(carrier);
+
+    Image *rgb = make_rgb_carrier(1920, 1080);
+    if (!rgb) return 1;
+    printf("\n%-14s %15s %10s %12s %12s %s\n", "packing", "secret", "capacity", "embed(MB/s)", "extract(MB/s)", "identical");
+    StegoPacking packings[] = {{1, 1}, {1, 3}, {2, 3}, {3, 3}, {4, 1}, {4, 3}};
+    for (size_t i = 0; i < sizeof(packings) / sizeof(packings[0]); i++) failures += run_packed_case(rgb, packings[i], frames);
+    delete_image(rgb);
+
+    failures += run_parallel_cases((unsigned int)(argc > 2 ? atoi(argv[2]) : 4096), frames);
+    return failures ? 1 : 0;
+}
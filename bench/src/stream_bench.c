@@ -0,0 +1,91 @@
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "qtree.h"
+#include "image.h"
+#include "qtree_binary.h"
+#include "qtree_stream.h"
+
+#include "bench_utils.h"
+
+// Runs one build in a child process so its peak RSS is not masked by earlier allocations.
+static int run_in_child(char *filename, char *output, double max_rmse, unsigned int band_rows, double *elapsed, long *peak_rss)
+{
+    double start = bench_now();
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        int ok;
+        if (band_rows > 0)
+        {
+            ok = create_quadtree_streaming(filename, output, max_rmse, band_rows, NULL);
+        }
+        else
+        {
+            Image *image = load_image(filename);
+            QTNode *root = image ? create_quadtree(image, max_rmse) : NULL;
+            ok = save_binary_qt(root, output);
+        }
+        _exit(ok ? 0 : 1);
+    }
+
+    int status = 0;
+    struct rusage usage;
+    if (pid < 0 || wait4(pid, &status, 0, &usage) != pid) return 0;
+    *elapsed = bench_now() - start;
+    *peak_rss = usage.ru_maxrss;
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+// Streams the image at each band height and compares the output with save_binary_qt of
+// the in-memory build (band 0).
+static int run_case(char *label, char *filename, double max_rmse)
+{
+    unsigned int band_rows[] = {0, 64, 256, 1024};
+    char *memory_output = "tests/output/stream_bench_0.qtb";
+    int failures = 0;
+    for (size_t i = 0; i < sizeof(band_rows) / sizeof(band_rows[0]); i++)
+    {
+        char output[64];
+        snprintf(output, sizeof(output), "tests/output/stream_bench_%u.qtb", band_rows[i]);
+        double elapsed = 0;
+        long peak_rss = 0;
+        int ok = run_in_child(filename, output, max_rmse, band_rows[i], &elapsed, &peak_rss);
+        int identical = ok && bench_files_equal(output, memory_output);
+        char band[16];
+        snprintf(band, sizeof(band), "%u", band_rows[i]);
+        printf("%-24s %-8s %12.3f %12ld %s\n", label, band_rows[i] ? band : "memory", elapsed * 1e3, peak_rss, identical ? "yes" : "NO");
+        if (!identical) failures++;
+        if (band_rows[i]) remove(output);
+    }
+    remove(memory_output);
+    return failures;
+}
+
+// Checks that create_quadtree_streaming writes the same tree as the in-memory builder and
+// compares time and peak memory on einstein2.ppm and a large synthetic P5 image.
+// Run from the repository root: ./build/stream_bench [synthetic side]
+int main(int argc, char **argv)
+{
+    unsigned int side = (unsigned int)(argc > 1 ? atoi(argv[1]) : 8192);
+    mkdir("tests/output", 0700);
+
+    printf("%-24s %-8s %12s %12s %s\n", "image", "band", "build(ms)", "peak RSS KB", "identical");
+    int failures = run_case("einstein2 rmse 5", "images/originals/einstein2.ppm", 5);
+
+    char *synthetic = "tests/output/stream_bench_synthetic.pgm";
+    Image *image = bench_synthetic_image(side, side - 3, BENCH_IMAGE_TEXTURED);
+    if (image && save_image(image, synthetic, IMAGE_FORMAT_P5))
+    {
+        delete_image(image);
+        failures += run_case("textured P5 rmse 10", synthetic, 10);
+        remove(synthetic);
+    }
+    else
+    {
+        delete_image(image);
+    }
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,88 @@
+#include <string.h>
+
+#include "qtree.h"
+#include "image.h"
+#include "qtree_sweep.h"
+
+#include "bench_utils.h"
+
+#define SWEEP_BENCH_MAX_THRESHOLDS 16
+
+// Mean squared error of a rendering against the image, computed from the pixels.
+static double pixel_mse(Image *image, unsigned char *pixels)
+{
+    unsigned long long squared_error = 0;
+    size_t count = (size_t)image->width * image->height;
+    for (size_t i = 0; i < count; i++)
+    {
+        long long diff = (long long)image->data[i] - pixels[i];
+        squared_error += (unsigned long long)(diff * diff);
+    }
+    return (double)squared_error / (double)count;
+}
+
+// Builds the error hierarchy once and extracts every threshold from it, against one
+// create_quadtree per threshold; trees, renderings and the curve's MSE are all checked.
+static int run_case(const char *label, Image *image, double *thresholds, int count)
+{
+    QTNode *extracted[SWEEP_BENCH_MAX_THRESHOLDS], *rebuilt[SWEEP_BENCH_MAX_THRESHOLDS];
+    double start = bench_now();
+    QTErrorHierarchy *hierarchy = create_qt_error_hierarchy(image, thresholds[0]);
+    double built = bench_now();
+    if (!hierarchy) return 1;
+    for (int i = 0; i < count; i++) extracted[i] = extract_quadtree_at(hierarchy, thresholds[i]);
+    double swept = bench_now();
+    for (int i = 0; i < count; i++) rebuilt[i] = create_quadtree(image, thresholds[i]);
+    double end = bench_now();
+
+    QTRatePoint points[SWEEP_BENCH_MAX_THRESHOLDS];
+    int identical = get_qt_rate_distortion(hierarchy, thresholds, count, points);
+    size_t size = (size_t)image->width * image->height;
+    for (int i = 0; i < count; i++)
+    {
+        unsigned char *pixels = render_qt_hierarchy_at(hierarchy, thresholds[i]);
+        unsigned char *expected = render_quadtree(rebuilt[i]);
+        if (!bench_trees_equal(extracted[i], rebuilt[i]) || !pixels || !expected || memcmp(pixels, expected, size) != 0 ||
+            pixel_mse(image, pixels) != points[i].mse)
+        {
+            identical = 0;
+        }
+        printf("%-24s %8.1f %10u %10u %10.3f\n", label, thresholds[i], points[i].node_count, points[i].leaf_count, points[i].psnr);
+        free(pixels);
+        free(expected);
+        delete_quadtree(extracted[i]);
+        delete_quadtree(rebuilt[i]);
+    }
+    printf("%-24s hierarchy %u nodes in %.3f ms; sweep %.3f ms vs rebuilds %.3f ms (%.1fx) %s\n\n", label, hierarchy->node_count,
+           (built - start) * 1e3, (swept - start) * 1e3, (end - swept) * 1e3, (end - swept) / (swept - start), identical ? "identical" : "DIFFERENT");
+    delete_qt_error_hierarchy(hierarchy);
+    return identical ? 0 : 1;
+}
+
+// Sweeps max_rmse over einstein2.ppm and synthetic images, printing the rate-distortion
+// curve and the time of one hierarchy plus extractions against one build per threshold.
+// Run from the repository root: ./build/sweep_bench [synthetic side]
+int main(int argc, char **argv)
+{
+    unsigned int side = (unsigned int)(argc > 1 ? atoi(argv[1]) : 2048);
+    double thresholds[] = {5, 10, 25, 50};
+    int count = (int)(sizeof(thresholds) / sizeof(thresholds[0]));
+
+    printf("%-24s %8s %10s %10s %10s\n", "image", "max_rmse", "nodes", "leaves", "PSNR(dB)");
+    int failures = 0;
+    Image *image = load_image("images/originals/einstein2.ppm");
+    if (image)
+    {
+        failures += run_case("einstein2", image, thresholds, count);
+        delete_image(image);
+    }
+    BenchImageKind kinds[] = {BENCH_IMAGE_GRADIENT, BENCH_IMAGE_TEXTURED};
+    for (size_t k = 0; k < sizeof(kinds) / sizeof(kinds[0]); k++)
+    {
+        image = bench_synthetic_image(side, side, kinds[k]);
+        if (!image) continue;
+        failures += run_case(bench_image_kind_name(kinds[k]), image, thresholds, count);
+        delete_image(image);
+    }
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,142 @@
+#include "qtree.h"
+#include "image.h"
+#include "region_sums.h"
+#include "tiled_image.h"
+
+#include "bench_utils.h"
+
+#define TILED_BENCH_SCAN_DEPTH 9
+
+// create_quadtree with a full scan of every region, the row-major counterpart of
+// create_quadtree_tiled.
+static QTNode *full_scan_quadtree(Image *image, QTRegion region, double max_rmse)
+{
+    QTNode *node = (QTNode *)malloc(sizeof(QTNode));
+    if (!node) return NULL;
+    node->width = region.width;
+    node->height = region.height;
+    node->is_leaf = evaluate_qt_region(image, region, max_rmse, &node->intensity);
+    QTRegion children[4];
+    split_qt_region(region, children);
+    for (int i = 0; i < 4; i++)
+    {
+        node->children[i] = !node->is_leaf && children[i].width > 0 ? full_scan_quadtree(image, children[i], max_rmse) : NULL;
+    }
+    return node;
+}
+
+// Sums every region of a complete quadtree down to `depth` levels, in preorder like a
+// build, from the row-major image or from the tiles; returns 0 if any pair differs.
+static int scan_regions(Image *image, TiledImage *tiled, QTRegion region, int depth, unsigned long long *checksum)
+{
+    unsigned long long sum, sum_sq, tiled_sum, tiled_sum_sq;
+    int ok = 1;
+    if (image) get_image_region_sums(image, region.col, region.row, region.width, region.height, &sum, &sum_sq);
+    if (tiled) get_tiled_region_sums(tiled, region.col, region.row, region.width, region.height, &tiled_sum, &tiled_sum_sq);
+    if (image && tiled) ok = sum == tiled_sum && sum_sq == tiled_sum_sq;
+    *checksum += image ? sum_sq : tiled_sum_sq;
+    if (depth == 0) return ok;
+    QTRegion children[4];
+    split_qt_region(region, children);
+    for (int i = 0; i < 4; i++)
+    {
+        if (children[i].width > 0) ok &= scan_regions(image, tiled, children[i], depth - 1, checksum);
+    }
+    return ok;
+}
+
+static double best_scan_time(Image *image, TiledImage *tiled, QTRegion region, int repeats, unsigned long long *checksum)
+{
+    double best = 1e30;
+    for (int rep = 0; rep < repeats; rep++)
+    {
+        double start = bench_now();
+        scan_regions(image, tiled, region, TILED_BENCH_SCAN_DEPTH, checksum);
+        double elapsed = bench_now() - start;
+        if (elapsed < best) best = elapsed;
+    }
+    return best;
+}
+
+static int run_case(const char *label, Image *image, double max_rmse, int repeats)
+{
+    double start = bench_now();
+    TiledImage *tiled = create_tiled_image(image);
+    double convert_time = bench_now() - start;
+    if (!tiled) return 1;
+
+    int identical = 1;
+    for (unsigned int row = 0; row < image->height && identical; row++)
+    {
+        for (unsigned int col = 0; col < image->width; col++)
+        {
+            if (get_tiled_image_intensity(tiled, row, col) != get_image_intensity(image, row, col)) identical = 0;
+        }
+    }
+    QTRegion region = {0, 0, (int)image->width, (int)image->height};
+    unsigned long long checksum = 0;
+    if (!scan_regions(image, tiled, region, TILED_BENCH_SCAN_DEPTH, &checksum)) identical = 0;
+    double row_major_scan = best_scan_time(image, NULL, region, repeats, &checksum);
+    double tiled_scan = best_scan_time(NULL, tiled, region, repeats, &checksum);
+
+    double full_time = 1e30, tiled_time = 1e30, create_time = 1e30;
+    for (int rep = 0; rep < repeats; rep++)
+    {
+        double t0 = bench_now();
+        QTNode *full = full_scan_quadtree(image, region, max_rmse);
+        double t1 = bench_now();
+        QTNode *from_tiles = create_quadtree_tiled(tiled, max_rmse);
+        double t2 = bench_now();
+        QTNode *expected = create_quadtree(image, max_rmse);
+        double t3 = bench_now();
+        if (t1 - t0 < full_time) full_time = t1 - t0;
+        if (t2 - t1 < tiled_time) tiled_time = t2 - t1;
+        if (t3 - t2 < create_time) create_time = t3 - t2;
+        if (!bench_trees_equal(full, expected) || !bench_trees_equal(from_tiles, expected)) identical = 0;
+        delete_quadtree(full);
+        delete_quadtree(from_tiles);
+        delete_quadtree(expected);
+    }
+
+    printf("%-22s %10.3f %10.3f %10.3f %7.2fx %10.3f %10.3f %7.2fx %10.3f %s\n", label, convert_time * 1e3, row_major_scan * 1e3, tiled_scan * 1e3,
+           row_major_scan / tiled_scan, full_time * 1e3, tiled_time * 1e3, full_time / tiled_time, create_time * 1e3, identical ? "yes" : "NO");
+    delete_tiled_image(tiled);
+    return identical ? 0 : 1;
+}
+
+// Compares the 64x64-tiled layout with row-major images: conversion cost, the time to sum
+// every region of the top levels of a quadtree, and full-scan builds each way, with
+// create_quadtree (which stops scanning busy regions early) for reference. Wide images
+// are where row-major regions span the most pages.
+// Run from the repository root: ./build/tiled_bench [max_rmse] [repeats]
+int main(int argc, char **argv)
+{
+    double max_rmse = argc > 1 ? atof(argv[1]) : 10;
+    int repeats = argc > 2 ? atoi(argv[2]) : 3;
+    printf("%-22s %10s %10s %10s %8s %10s %10s %8s %10s %s\n", "image", "convert", "scan rows", "scan tiles", "scan", "build rows", "build tiles",
+           "build", "create_qt", "identical");
+    printf("%-22s %10s %10s %10s %8s %10s %10s %8s %10s\n", "", "(ms)", "(ms)", "(ms)", "speedup", "(ms)", "(ms)", "speedup", "(ms)");
+    int failures = 0;
+    Image *image = load_image("images/originals/einstein2.ppm");
+    if (image)
+    {
+        failures += run_case("einstein2", image, max_rmse, repeats);
+        delete_image(image);
+    }
+
+    struct
+    {
+        unsigned int width, height;
+        BenchImageKind kind;
+    } cases[] = {{4096, 4096, BENCH_IMAGE_TEXTURED}, {8192, 1024, BENCH_IMAGE_TEXTURED}, {8192, 1024, BENCH_IMAGE_NOISE}, {16384, 512, BENCH_IMAGE_GRADIENT}};
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+    {
+        image = bench_synthetic_image(cases[i].width, cases[i].height, cases[i].kind);
+        if (!image) continue;
+        char label[64];
+        snprintf(label, sizeof(label), "%s %ux%u", bench_image_kind_name(cases[i].kind), cases[i].width, cases[i].height);
+        failures += run_case(label, image, max_rmse, repeats);
+        delete_image(image);
+    }
+    return failures ? 1 : 0;
+}
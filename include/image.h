@@ -7,21 +7,49 @@
 #define INFO(...) do {fprintf(stderr, "[          ] [ INFO ] "); fprintf(stderr, __VA_ARGS__); fprintf(stderr, "\n"); fflush(stderr);} while(0)
 #define ERROR(...) do {fprintf(stderr, "[          ] [ ERR  ] "); fprintf(stderr, __VA_ARGS__); fprintf(stderr, "\n"); fflush(stderr);} while(0) 
 
+typedef enum ImageFormat
+{
+    IMAGE_FORMAT_P3,
+    IMAGE_FORMAT_P5,
+    IMAGE_FORMAT_P6
+} ImageFormat;
+
 typedef struct Image
 {
-    unsigned short width;
-    unsigned short height;
+    unsigned int width;
+    unsigned int height;
+    unsigned char channels;
     unsigned char *data;
 } Image;
 
+// Decodes a PPM/PGM top to bottom a few rows at a time, for images too large to load whole.
+typedef struct ImageReader
+{
+    FILE *file;
+    ImageFormat format;
+    unsigned int width;
+    unsigned int height;
+    unsigned int next_row;
+    unsigned char *row_buffer;
+} ImageReader;
+
+Image *create_image(unsigned int width, unsigned int height, unsigned char channels);
 Image *load_image(char *filename);
+Image *load_image_rgb(char *filename);
+ImageReader *open_image_reader(char *filename);
+int read_image_rows(ImageReader *reader, unsigned char *rows, unsigned int row_count);
+void close_image_reader(ImageReader *reader);
+int save_image(Image *image, char *filename, ImageFormat format);
 void delete_image(Image *image);
 unsigned char get_image_intensity(Image *image, unsigned int row, unsigned int col);
-unsigned short get_image_width(Image *image);
-unsigned short get_image_height(Image *image);
+unsigned int get_image_width(Image *image);
+unsigned int get_image_height(Image *image);
 unsigned int hide_message(char *message, char *input_filename, char *output_filename);
 char *reveal_message(char *input_filename);
 unsigned int hide_image(char *secret_image_filename, char *input_filename, char *output_filename);
 void reveal_image(char *input_filename, char *output_filename);
+unsigned int hide_message_format(char *message, char *input_filename, char *output_filename, ImageFormat format);
+unsigned int hide_image_format(char *secret_image_filename, char *input_filename, char *output_filename, ImageFormat format);
+void reveal_image_format(char *input_filename, char *output_filename, ImageFormat format);
 
 #endif // __IMAGE_H
\ No newline at end of file
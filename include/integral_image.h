@@ -0,0 +1,20 @@
+#ifndef INTEGRAL_IMAGE_H
+#define INTEGRAL_IMAGE_H
+
+#include "image.h"
+
+// Summed-area tables of intensity and intensity^2 with a zero guard row/column,
+// so any region sum is four lookups: entry (r, c) covers rows [0, r) x cols [0, c).
+typedef struct IntegralImage
+{
+    unsigned int width;
+    unsigned int height;
+    unsigned long long *sum;
+    unsigned long long *sum_sq;
+} IntegralImage;
+
+IntegralImage *create_integral_image(Image *image);
+void delete_integral_image(IntegralImage *integral);
+void get_integral_region(IntegralImage *integral, int x, int y, int width, int height, unsigned long long *sum, unsigned long long *sum_sq);
+
+#endif // INTEGRAL_IMAGE_H
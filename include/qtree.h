@@ -17,15 +17,32 @@ typedef struct QTNode
     int height;  
 } QTNode;
 
+typedef struct QTRegion
+{
+    int row;
+    int col;
+    int width;
+    int height;
+} QTRegion;
+
 QTNode *create_quadtree(Image *image, double max_rmse);
+QTNode *create_quadtree_sat(Image *image, double max_rmse);
+QTNode *create_quadtree_region(Image *image, QTRegion region, double max_rmse);
+QTNode *create_quadtree_parallel(Image *image, double max_rmse, int num_threads, int serial_cutoff_pixels);
+int evaluate_qt_region(Image *image, QTRegion region, double max_rmse, unsigned char *intensity);
+double calculate_qt_region_rmse(QTRegion region, unsigned long long sum, unsigned long long sum_sq, unsigned char *intensity);
+int evaluate_qt_region_sums(QTRegion region, unsigned long long sum, unsigned long long sum_sq, double max_rmse, unsigned char *intensity);
 QTNode *get_child1(QTNode *node);
 QTNode *get_child2(QTNode *node);
 QTNode *get_child3(QTNode *node);
 QTNode *get_child4(QTNode *node);
 unsigned char get_node_intensity(QTNode *node);
+int split_qt_region(QTRegion region, QTRegion children[4]);
 void delete_quadtree(QTNode *root);
 QTNode *load_preorder_qt(char *filename);
-void save_preorder_qt(QTNode *root, char *filename);
-void save_qtree_as_ppm(QTNode *root, char *filename);
+int save_preorder_qt(QTNode *root, char *filename);
+unsigned char *render_quadtree(QTNode *root);
+int save_qtree_as_ppm(QTNode *root, char *filename);
+int save_qtree_as_ppm_format(QTNode *root, char *filename, ImageFormat format);
 
 #endif // QTREE_H
\ No newline at end of file
@@ -0,0 +1,31 @@
+#ifndef QTREE_ARENA_H
+#define QTREE_ARENA_H
+
+#include <stddef.h>
+#include "qtree.h"
+
+// Nodes are carved from geometrically growing blocks and only released all at once,
+// so trees built in an arena must be freed with delete_qt_arena, never delete_quadtree.
+typedef struct QTArenaBlock
+{
+    struct QTArenaBlock *next;
+    size_t used;
+    size_t capacity;
+    QTNode nodes[];
+} QTArenaBlock;
+
+typedef struct QTArena
+{
+    QTArenaBlock *blocks;
+    size_t next_capacity;
+    size_t node_count;
+} QTArena;
+
+QTArena *create_qt_arena(size_t initial_nodes);
+QTNode *qt_arena_alloc_node(QTArena *arena);
+void reset_qt_arena(QTArena *arena);
+void delete_qt_arena(QTArena *arena);
+QTNode *create_quadtree_arena(QTArena *arena, Image *image, double max_rmse);
+QTNode *load_preorder_qt_arena(QTArena *arena, char *filename);
+
+#endif // QTREE_ARENA_H
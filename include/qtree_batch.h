@@ -0,0 +1,63 @@
+#ifndef QTREE_BATCH_H
+#define QTREE_BATCH_H
+
+#include <stddef.h>
+#include "qtree.h"
+
+#define QT_BATCH_DEFAULT_QUEUE_CAPACITY 8
+
+// A batch runs three stages connected by bounded queues: load_image, create_quadtree, then
+// save_preorder_qt (QT_BATCH_PREORDER, "<stem>.txt") or save_qtree_as_ppm_format
+// ("<stem>.ppm") into output_directory. Each stage has its own worker threads; a worker
+// whose output queue is full waits, so at most the workers plus both queues' capacities
+// hold images or trees at once, however many inputs there are.
+typedef enum QTBatchOutput
+{
+    QT_BATCH_PREORDER,
+    QT_BATCH_PPM
+} QTBatchOutput;
+
+typedef enum QTBatchStageKind
+{
+    QT_BATCH_LOAD,
+    QT_BATCH_BUILD,
+    QT_BATCH_SAVE,
+    QT_BATCH_STAGE_COUNT
+} QTBatchStageKind;
+
+typedef struct QTBatchOptions
+{
+    double max_rmse;
+    QTBatchOutput output;
+    ImageFormat format; // for QT_BATCH_PPM
+    char *output_directory;
+    int workers[QT_BATCH_STAGE_COUNT];
+    int queue_capacity;
+} QTBatchOptions;
+
+// Times are summed over a stage's workers: busy running the stage's function, starved
+// waiting for input and blocked waiting for room in the next queue (back-pressure).
+typedef struct QTBatchStageStats
+{
+    int workers;
+    size_t items;
+    size_t failures;
+    double busy_seconds;
+    double starved_seconds;
+    double blocked_seconds;
+} QTBatchStageStats;
+
+typedef struct QTBatchReport
+{
+    size_t inputs;
+    size_t completed;
+    double elapsed_seconds;
+    QTBatchStageStats stages[QT_BATCH_STAGE_COUNT];
+} QTBatchReport;
+
+void init_qt_batch_options(QTBatchOptions *options, double max_rmse, QTBatchOutput output, char *output_directory);
+int run_qt_batch(char **input_files, size_t input_count, QTBatchOptions *options, QTBatchReport *report);
+int get_qt_batch_output_path(char *input_file, QTBatchOptions *options, char *path, size_t path_size);
+const char *qt_batch_stage_name(QTBatchStageKind stage);
+
+#endif // QTREE_BATCH_H
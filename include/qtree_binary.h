@@ -0,0 +1,54 @@
+#ifndef QTREE_BINARY_H
+#define QTREE_BINARY_H
+
+#include "qtree.h"
+
+#define QT_BINARY_MAGIC "QTB"
+#define QT_BINARY_VERSION 1
+#define QT_BINARY_HEADER_SIZE 12
+#define QT_BINARY_BUFFER_SIZE 8192
+
+// Binary preorder layout: a 12-byte header ("QTB", version, little-endian 32-bit width
+// and height) followed by nodes in preorder, in groups of eight. Each group is one flag
+// byte (bit i set = node i is internal) and then the group's intensity bytes. Region
+// geometry is not stored; readers re-derive it from the root with split_qt_region.
+typedef struct QTBinaryWriter
+{
+    FILE *file;
+    int failed;
+    unsigned char group[9];
+    int group_count;
+    size_t used;
+    unsigned char buffer[QT_BINARY_BUFFER_SIZE];
+} QTBinaryWriter;
+
+typedef struct QTBinaryReader
+{
+    FILE *file;
+    int width;
+    int height;
+    unsigned char flags;
+    int group_left;
+    size_t position;
+    size_t length;
+    unsigned char buffer[QT_BINARY_BUFFER_SIZE];
+} QTBinaryReader;
+
+QTBinaryWriter *open_binary_qt_writer(char *filename, int width, int height);
+QTBinaryWriter *attach_binary_qt_writer(FILE *file);
+int write_binary_qt_node(QTBinaryWriter *writer, int is_leaf, unsigned char intensity);
+int write_binary_qt_subtree(QTBinaryWriter *writer, QTNode *node, QTRegion region);
+int detach_binary_qt_writer(QTBinaryWriter *writer);
+int close_binary_qt_writer(QTBinaryWriter *writer);
+QTBinaryReader *open_binary_qt_reader(char *filename);
+QTBinaryReader *attach_binary_qt_reader(FILE *file, int width, int height);
+int read_binary_qt_node(QTBinaryReader *reader, int *is_leaf, unsigned char *intensity);
+QTNode *read_binary_qt_subtree(QTBinaryReader *reader, QTRegion region);
+void detach_binary_qt_reader(QTBinaryReader *reader);
+void close_binary_qt_reader(QTBinaryReader *reader);
+int save_binary_qt(QTNode *root, char *filename);
+QTNode *load_binary_qt(char *filename);
+int convert_preorder_qt_to_binary(char *text_filename, char *binary_filename);
+int convert_binary_qt_to_preorder(char *binary_filename, char *text_filename);
+
+#endif // QTREE_BINARY_H
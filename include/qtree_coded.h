@@ -0,0 +1,127 @@
+#ifndef QTREE_CODED_H
+#define QTREE_CODED_H
+
+#include "qtree.h"
+
+#define QT_CODED_MAGIC "QTC"
+#define QT_CODED_VERSION 3
+#define QT_CODED_HEADER_SIZE 12
+#define QT_CODED_BUFFER_SIZE 8192
+#define QT_CODED_STACK_SIZE 256
+#define QT_CODED_DEPTHS 64
+#define QT_CODED_LEVELS 12
+#define QT_CODED_CONTEXTS (2 * QT_CODED_LEVELS)
+#define QT_CODED_SYMBOLS 32
+#define QT_CODED_MAX_CODE_LENGTH 10
+#define QT_CODED_TABLE_SIZE (1 << QT_CODED_MAX_CODE_LENGTH)
+#define QT_CODED_FIRST_REBUILD 32
+#define QT_CODED_MAX_REBUILD 4096
+#define QT_CODED_BATCH 256
+#define QT_CODED_STEP_NODES 5
+
+// Entropy-coded preorder layout: a 12-byte header ("QTC", version, little-endian 32-bit
+// width and height) followed by the nodes in preorder as one LSB-first bit stream. Each
+// node codes its intensity as the zigzagged difference from a prediction: the parent's
+// intensity, or for the last child of a node, the value that makes the children's sizes
+// and intensities average to the parent's. The difference is sent as a symbol for its bit
+// length and the bit below its leading one, followed by its remaining bits as they are;
+// a node larger than 1x1 folds its split flag into the symbol. Symbols are Huffman coded
+// in a context per level (the region's depth counted up from single pixels, so split
+// flags are conditioned on it) and per last child or not. The codes adapt: encoder and
+// decoder count every context's symbols and rebuild its code from the counts after
+// QT_CODED_FIRST_REBUILD symbols, then after twice as many each time up to
+// QT_CODED_MAX_REBUILD, halving the counts from then on so old statistics fade. Encoder
+// and decoder track region geometry the same way, so the stream needs no node count, end
+// marker or code tables.
+typedef struct QTCodedFamily
+{
+    unsigned char intensity;
+    int children_left;
+    unsigned long long pixel_count;
+    unsigned long long children_sum;
+} QTCodedFamily;
+
+typedef struct QTCodedFrame
+{
+    QTRegion region;
+    int depth;
+} QTCodedFrame;
+
+// One context's adaptive statistics and its current code lengths. 1x1 regions are always
+// leaves, so their contexts use only the first 16 symbols.
+typedef struct QTCodedContext
+{
+    unsigned int counts[QT_CODED_SYMBOLS];
+    unsigned char lengths[QT_CODED_SYMBOLS];
+    int symbol_count;
+    unsigned int until_rebuild;
+    unsigned int interval;
+} QTCodedContext;
+
+typedef struct QTCodedModel
+{
+    QTCodedContext contexts[QT_CODED_CONTEXTS];
+    QTCodedFamily families[QT_CODED_DEPTHS];
+    QTCodedFrame stack[QT_CODED_STACK_SIZE];
+    int top;
+} QTCodedModel;
+
+// Each node's bits go out through `buffer` as soon as it is written.
+typedef struct QTCodedWriter
+{
+    FILE *file;
+    int failed;
+    QTCodedModel model;
+    unsigned short codes[QT_CODED_CONTEXTS][QT_CODED_SYMBOLS];
+    unsigned long long bits;
+    int bit_count;
+    size_t used;
+    unsigned char buffer[QT_CODED_BUFFER_SIZE];
+} QTCodedWriter;
+
+typedef struct QTCodedNode
+{
+    QTRegion region;
+    int is_leaf;
+    unsigned char intensity;
+} QTCodedNode;
+
+// The reader decodes up to QT_CODED_BATCH nodes at a time, into `pending` for
+// read_coded_qt_node or straight into the caller's array for read_coded_qt_nodes; a
+// decoding step emits at most QT_CODED_STEP_NODES nodes (a 2x2 region and its pixels).
+// A table entry describes the code its index starts with: the bits it takes with the
+// difference's remaining bits (bits 0-4), the code length (5-8), the split flag (9), the
+// count of remaining bits (10-12), the difference's top bits (16-23) and the symbol
+// (24-28). `overrun` counts the zero bits fed in past the end of the file.
+typedef struct QTCodedReader
+{
+    FILE *file;
+    int width;
+    int height;
+    int failed;
+    QTCodedModel model;
+    unsigned long long bits;
+    int bit_count;
+    int overrun;
+    size_t position;
+    size_t length;
+    int pending_count;
+    int pending_next;
+    QTCodedNode pending[QT_CODED_BATCH];
+    unsigned int tables[QT_CODED_CONTEXTS][QT_CODED_TABLE_SIZE];
+    unsigned char buffer[QT_CODED_BUFFER_SIZE];
+} QTCodedReader;
+
+QTCodedWriter *open_coded_qt_writer(char *filename, int width, int height);
+int write_coded_qt_node(QTCodedWriter *writer, int is_leaf, unsigned char intensity);
+int close_coded_qt_writer(QTCodedWriter *writer);
+QTCodedReader *open_coded_qt_reader(char *filename);
+int read_coded_qt_node(QTCodedReader *reader, QTRegion *region, int *is_leaf, unsigned char *intensity);
+int read_coded_qt_nodes(QTCodedReader *reader, QTCodedNode *nodes, int capacity);
+void close_coded_qt_reader(QTCodedReader *reader);
+int save_coded_qt(QTNode *root, char *filename);
+QTNode *load_coded_qt(char *filename);
+int convert_preorder_qt_to_coded(char *text_filename, char *coded_filename);
+int convert_coded_qt_to_preorder(char *coded_filename, char *text_filename);
+
+#endif // QTREE_CODED_H
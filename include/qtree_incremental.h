@@ -0,0 +1,28 @@
+#ifndef QTREE_INCREMENTAL_H
+#define QTREE_INCREMENTAL_H
+
+#include "qtree.h"
+
+// Intensity sum and sum of squares of every node's region, mirroring the QTNode tree, so
+// ancestors of an edit are re-decided from their children instead of rescanning pixels.
+typedef struct QTSumsNode
+{
+    unsigned long long sum;
+    unsigned long long sum_sq;
+    struct QTSumsNode *children[4];
+} QTSumsNode;
+
+// Owns a malloc-built tree (not an arena tree) and its sums. After each edit of the image,
+// update_qt_incremental leaves root equal to create_quadtree of the edited image.
+typedef struct QTIncremental
+{
+    QTNode *root;
+    QTSumsNode *sums;
+    double max_rmse;
+} QTIncremental;
+
+QTIncremental *create_qt_incremental(QTNode *root, Image *image, double max_rmse);
+int update_qt_incremental(QTIncremental *tracker, Image *image, QTRegion dirty);
+void delete_qt_incremental(QTIncremental *tracker);
+
+#endif // QTREE_INCREMENTAL_H
@@ -0,0 +1,32 @@
+#ifndef QTREE_LINEAR_H
+#define QTREE_LINEAR_H
+
+#include "qtree.h"
+
+// A pointer-free quadtree: nodes are stored in preorder, a node's first child is the
+// next entry and `end` indexes one past its subtree (so also its next sibling).
+// Region geometry is not stored; it is re-derived from the root with split_qt_region.
+typedef struct LinearQTNode
+{
+    unsigned int end;
+    unsigned char intensity;
+    unsigned char is_leaf;
+} LinearQTNode;
+
+typedef struct LinearQTree
+{
+    int width;
+    int height;
+    unsigned int node_count;
+    LinearQTNode *nodes;
+} LinearQTree;
+
+LinearQTree *linearize_quadtree(QTNode *root);
+QTNode *delinearize_quadtree(LinearQTree *tree);
+void delete_linear_qtree(LinearQTree *tree);
+unsigned char *render_linear_qtree(LinearQTree *tree);
+LinearQTree *load_linear_preorder_qt(char *filename);
+int save_linear_preorder_qt(LinearQTree *tree, char *filename);
+int save_linear_qtree_as_ppm(LinearQTree *tree, char *filename, ImageFormat format);
+
+#endif // QTREE_LINEAR_H
@@ -0,0 +1,50 @@
+#ifndef QTREE_MAPPED_H
+#define QTREE_MAPPED_H
+
+#include <stddef.h>
+#include "qtree.h"
+
+#define QT_MAPPED_MAGIC "QTM"
+#define QT_MAPPED_VERSION 1
+#define QT_MAPPED_HEADER_SIZE 16
+#define QT_MAPPED_ENTRY_SIZE 8
+#define QT_MAPPED_NONE 0xFFFFFFFFu
+
+// On-disk LinearQTree: a 16-byte header ("QTM", version, little-endian 32-bit width,
+// height and node count) followed by one 8-byte entry per node in preorder: 32-bit
+// little-endian `end` (index one past the subtree), intensity, leaf flag and two zero
+// bytes. `end` is the preorder index of the next sibling, so a reader can skip any subtree
+// without touching it; opening only maps the file and queries fault in the pages they visit.
+typedef struct MappedQTree
+{
+    int width;
+    int height;
+    unsigned int node_count;
+    const unsigned char *entries;
+    void *mapping;
+    size_t mapping_size;
+} MappedQTree;
+
+// A node handle: its preorder index and the region it covers. index is QT_MAPPED_NONE
+// for a child slot the region's geometry leaves empty.
+typedef struct MappedQTNode
+{
+    unsigned int index;
+    QTRegion region;
+} MappedQTNode;
+
+int save_mapped_qt(QTNode *root, char *filename);
+MappedQTree *open_mapped_qt(char *filename);
+void close_mapped_qt(MappedQTree *tree);
+MappedQTNode get_mapped_root(MappedQTree *tree);
+MappedQTNode get_mapped_child(MappedQTree *tree, MappedQTNode node, int slot);
+MappedQTNode get_mapped_child1(MappedQTree *tree, MappedQTNode node);
+MappedQTNode get_mapped_child2(MappedQTree *tree, MappedQTNode node);
+MappedQTNode get_mapped_child3(MappedQTree *tree, MappedQTNode node);
+MappedQTNode get_mapped_child4(MappedQTree *tree, MappedQTNode node);
+int is_mapped_leaf(MappedQTree *tree, MappedQTNode node);
+unsigned char get_mapped_intensity(MappedQTree *tree, MappedQTNode node);
+unsigned char query_mapped_qt_point(MappedQTree *tree, int row, int col);
+QTNode *materialize_mapped_subtree(MappedQTree *tree, MappedQTNode node);
+
+#endif // QTREE_MAPPED_H
@@ -0,0 +1,36 @@
+#ifndef QTREE_POLICY_H
+#define QTREE_POLICY_H
+
+#include "qtree.h"
+
+// What makes a region uniform enough to become a leaf: its RMSE around the truncated mean
+// (create_quadtree's rule), or the largest |pixel - truncated mean| in it. The deviation
+// scan stops at the first row that exceeds the threshold.
+typedef enum QTSplitRule
+{
+    QT_SPLIT_RMSE,
+    QT_SPLIT_MAX_DEVIATION
+} QTSplitRule;
+
+// Limits apply on top of the rule; 0 disables each one.
+//  - min_block_size: regions no more than this many pixels on each side become leaves.
+//  - max_depth: nodes at this depth (the root is depth 0) become leaves.
+//  - node_budget: the tree is refined best-first, always splitting the leaf with the
+//    largest squared error next and skipping any split that would exceed the budget.
+// With every limit off the result is the same tree a depth-first build produces; with
+// QT_SPLIT_RMSE that is create_quadtree's tree.
+typedef struct QTSplitPolicy
+{
+    QTSplitRule rule;
+    double threshold;
+    int min_block_size;
+    int max_depth;
+    unsigned int node_budget;
+} QTSplitPolicy;
+
+void init_qt_split_policy(QTSplitPolicy *policy, QTSplitRule rule, double threshold);
+int evaluate_qt_region_policy(Image *image, QTRegion region, int depth, QTSplitPolicy *policy, unsigned char *intensity,
+                              unsigned long long *squared_error);
+QTNode *create_quadtree_policy(Image *image, QTSplitPolicy *policy);
+
+#endif // QTREE_POLICY_H
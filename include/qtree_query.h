@@ -0,0 +1,22 @@
+#ifndef QTREE_QUERY_H
+#define QTREE_QUERY_H
+
+#include <stddef.h>
+#include "qtree.h"
+
+// Statistics of the reconstructed image over a query rectangle, clipped to the tree.
+// mean is weighted by how many pixels of each leaf fall inside the rectangle.
+typedef struct QTRegionStats
+{
+    unsigned long long pixel_count;
+    double mean;
+    unsigned char min;
+    unsigned char max;
+    size_t leaf_count;
+} QTRegionStats;
+
+unsigned char query_qt_point(QTNode *root, int row, int col);
+int query_qt_region(QTNode *root, QTRegion query, QTRegionStats *stats, QTNode ***leaves);
+int query_qt_points(QTNode *root, const int *rows, const int *cols, size_t count, unsigned char *intensities);
+
+#endif // QTREE_QUERY_H
@@ -0,0 +1,68 @@
+#ifndef QTREE_STATS_H
+#define QTREE_STATS_H
+
+#include "qtree.h"
+
+#define QT_STATS_DEPTHS 64
+#define QT_STATS_LEVELS 32
+
+// Opt-in instrumentation of the public build and I/O entry points. Configure with
+// -DQTREE_ENABLE_STATS=ON to define QTREE_STATS; otherwise every hook below compiles to
+// nothing and get_qt_stats reports zeros. Counters are process-wide and updated
+// atomically, so calls from several threads accumulate into the same totals.
+typedef enum QTStatsPhase
+{
+    QT_STATS_PARSE,     // load_image, load_image_rgb, load_preorder_qt
+    QT_STATS_BUILD,     // create_quadtree and its _sat, _parallel, _arena, _policy and _tiled variants
+    QT_STATS_SERIALIZE, // save_image, save_preorder_qt
+    QT_STATS_RENDER,    // render_quadtree
+    QT_STATS_PHASE_COUNT
+} QTStatsPhase;
+
+// Per-depth counts cover the trees returned by the build functions. area_by_depth sums
+// the pixel area of each level's regions; it is not the pixels scanned, since builds
+// can stop scanning a region once it is known to split. The scanners do not know a
+// region's depth, so scanned pixels are bucketed by region level instead: 0 for a single
+// pixel, otherwise the bit length of the longer side minus one. area_by_level buckets the
+// tree's regions the same way, so the two arrays compare level for level.
+typedef struct QTStats
+{
+    double phase_seconds[QT_STATS_PHASE_COUNT];
+    unsigned long long phase_calls[QT_STATS_PHASE_COUNT];
+    unsigned long long nodes_by_depth[QT_STATS_DEPTHS];
+    unsigned long long leaves_by_depth[QT_STATS_DEPTHS];
+    unsigned long long area_by_depth[QT_STATS_DEPTHS];
+    unsigned long long area_by_level[QT_STATS_LEVELS];
+    unsigned long long scanned_by_level[QT_STATS_LEVELS];
+    unsigned long long bytes_read;
+    unsigned long long bytes_written;
+} QTStats;
+
+int qt_stats_enabled(void);
+void reset_qt_stats(void);
+void get_qt_stats(QTStats *stats);
+const char *qt_stats_phase_name(QTStatsPhase phase);
+void write_qt_stats_json(QTStats *stats, FILE *file);
+int save_qt_stats_json(QTStats *stats, char *filename);
+
+double qt_stats_clock(void);
+void record_qt_phase(QTStatsPhase phase, double seconds);
+void record_qt_bytes(long long bytes_read, long long bytes_written);
+void record_qt_tree(QTNode *root);
+void record_qt_scan(int width, int height, unsigned long long pixels);
+
+#ifdef QTREE_STATS
+#define QT_STATS_START(start) double start = qt_stats_clock()
+#define QT_STATS_PHASE(phase, start) record_qt_phase(phase, qt_stats_clock() - (start))
+#define QT_STATS_BYTES(bytes_read, bytes_written) record_qt_bytes(bytes_read, bytes_written)
+#define QT_STATS_TREE(root) record_qt_tree(root)
+#define QT_STATS_SCAN(width, height, pixels) record_qt_scan(width, height, pixels)
+#else
+#define QT_STATS_START(start) ((void)0)
+#define QT_STATS_PHASE(phase, start) ((void)0)
+#define QT_STATS_BYTES(bytes_read, bytes_written) ((void)0)
+#define QT_STATS_TREE(root) ((void)0)
+#define QT_STATS_SCAN(width, height, pixels) ((void)0)
+#endif
+
+#endif // QTREE_STATS_H
@@ -0,0 +1,17 @@
+#ifndef QTREE_STREAM_H
+#define QTREE_STREAM_H
+
+#include "qtree.h"
+
+#define QT_STREAM_DEFAULT_BAND_ROWS 256
+
+// Builds the quadtree of an image file without loading it whole. The root is split, with
+// the builder's rules, until every region is at most band_rows tall; those regions are
+// the tiles. Tiles sharing a row range form a band, which is read, built tile by tile and
+// spilled as binary node streams. Ancestors are then decided from the tiles' exact sums,
+// so the binary preorder written to output_filename matches save_binary_qt of
+// create_quadtree on the same image. Peak pixel memory is band_rows x width bytes.
+// Spills go to spill_filename, or to an anonymous tmpfile() when it is NULL.
+int create_quadtree_streaming(char *image_filename, char *output_filename, double max_rmse, unsigned int band_rows, char *spill_filename);
+
+#endif // QTREE_STREAM_H
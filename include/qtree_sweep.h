@@ -0,0 +1,49 @@
+#ifndef QTREE_SWEEP_H
+#define QTREE_SWEEP_H
+
+#include "qtree.h"
+#include "qtree_linear.h"
+
+// One node of the error hierarchy, in the preorder layout of LinearQTNode. rmse is the
+// value the builder compares with max_rmse; squared_error is the exact sum of squared
+// differences from the node's intensity, i.e. the distortion if the node becomes a leaf.
+typedef struct QTErrorNode
+{
+    double rmse;
+    unsigned long long squared_error;
+    unsigned int end;
+    unsigned char intensity;
+    unsigned char is_leaf;
+} QTErrorNode;
+
+// The tree create_quadtree builds at min_rmse, with every node's error recorded. For any
+// max_rmse >= min_rmse, the tree create_quadtree builds is this one with each node whose
+// rmse <= max_rmse cut back to a leaf, so a whole sweep needs a single pass over the pixels.
+typedef struct QTErrorHierarchy
+{
+    int width;
+    int height;
+    double min_rmse;
+    unsigned int node_count;
+    QTErrorNode *nodes;
+} QTErrorHierarchy;
+
+// One point of a rate-distortion curve: tree size and reconstruction quality at max_rmse.
+typedef struct QTRatePoint
+{
+    double max_rmse;
+    unsigned int node_count;
+    unsigned int leaf_count;
+    double mse;
+    double psnr;
+} QTRatePoint;
+
+QTErrorHierarchy *create_qt_error_hierarchy(Image *image, double min_rmse);
+void delete_qt_error_hierarchy(QTErrorHierarchy *hierarchy);
+unsigned int count_qt_nodes_at(QTErrorHierarchy *hierarchy, double max_rmse);
+LinearQTree *extract_linear_qtree_at(QTErrorHierarchy *hierarchy, double max_rmse);
+QTNode *extract_quadtree_at(QTErrorHierarchy *hierarchy, double max_rmse);
+unsigned char *render_qt_hierarchy_at(QTErrorHierarchy *hierarchy, double max_rmse);
+int get_qt_rate_distortion(QTErrorHierarchy *hierarchy, double *thresholds, int count, QTRatePoint *points);
+
+#endif // QTREE_SWEEP_H
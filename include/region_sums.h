@@ -0,0 +1,23 @@
+#ifndef REGION_SUMS_H
+#define REGION_SUMS_H
+
+#include "image.h"
+
+// One-pass sum and sum of squares of a region's intensities, scanned as contiguous row
+// spans. The SSE2/AVX2 kernels are picked at first use from what the CPU supports; all
+// kernels return identical integer results. The region must lie inside the image.
+typedef enum RegionSumsKernel
+{
+    REGION_SUMS_AUTO,
+    REGION_SUMS_SCALAR,
+    REGION_SUMS_SSE2,
+    REGION_SUMS_AVX2
+} RegionSumsKernel;
+
+int select_region_sums_kernel(RegionSumsKernel kernel);
+const char *region_sums_kernel_name(void);
+void get_image_region_sums(Image *image, int x, int y, int width, int height, unsigned long long *sum, unsigned long long *sum_sq);
+void add_strided_region_sums(const unsigned char *data, size_t stride, int width, int height, unsigned long long *sum, unsigned long long *sum_sq);
+int get_image_region_sums_bounded(Image *image, int x, int y, int width, int height, unsigned long long split_error, unsigned long long *sum, unsigned long long *sum_sq);
+
+#endif // REGION_SUMS_H
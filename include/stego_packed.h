@@ -0,0 +1,32 @@
+#ifndef STEGO_PACKED_H
+#define STEGO_PACKED_H
+
+#include "image.h"
+
+// A packed carrier keeps the secret's parameters in the red LSBs of its first
+// STEGO_HEADER_PIXELS pixels: an 8-bit magic, 4-bit bits per channel, 4-bit channel count
+// and 32-bit width and height, most significant bit first. The secret's grayscale bytes
+// follow as one bit stream, bits_per_channel bits in the low bits of each used channel
+// of the remaining pixels (red only, or red, green and blue).
+#define STEGO_HEADER_PIXELS 80
+#define STEGO_MAGIC 0x5A
+// Work unit of the threaded embed/extract; a multiple of 8 pixels.
+#define STEGO_CHUNK_PIXELS (1 << 16)
+
+typedef struct StegoPacking
+{
+    unsigned char bits_per_channel; // 1 to 4
+    unsigned char channels;         // 1 (red only) or 3 (RGB)
+} StegoPacking;
+
+unsigned long long get_stego_capacity(unsigned int width, unsigned int height, StegoPacking packing);
+int embed_packed_image(Image *carrier, Image *secret, StegoPacking packing);
+Image *extract_packed_image(Image *carrier);
+unsigned int hide_image_packed(char *secret_image_filename, char *input_filename, char *output_filename, StegoPacking packing, ImageFormat format);
+int reveal_image_packed(char *input_filename, char *output_filename, ImageFormat format);
+int embed_packed_image_parallel(Image *carrier, Image *secret, StegoPacking packing, int num_threads);
+Image *extract_packed_image_parallel(Image *carrier, int num_threads);
+unsigned int hide_image_packed_parallel(char *secret_image_filename, char *input_filename, char *output_filename, StegoPacking packing, int num_threads);
+int reveal_image_packed_parallel(char *input_filename, char *output_filename, int num_threads);
+
+#endif // STEGO_PACKED_H
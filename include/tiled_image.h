@@ -0,0 +1,30 @@
+#ifndef TILED_IMAGE_H
+#define TILED_IMAGE_H
+
+#include "qtree.h"
+
+#define TILED_IMAGE_TILE_SHIFT 6
+#define TILED_IMAGE_TILE_SIZE (1 << TILED_IMAGE_TILE_SHIFT)
+#define TILED_IMAGE_TILE_PIXELS (TILED_IMAGE_TILE_SIZE * TILED_IMAGE_TILE_SIZE)
+
+// Grayscale intensities in 64x64 tiles of 4 KB, tiles stored left to right and top to
+// bottom and pixels row-major inside each tile, so one tile row is one 64-byte cache line
+// and a region inside a tile stays within one page however wide the image is. Edge tiles
+// are padded with zeros, which no region ever reads.
+typedef struct TiledImage
+{
+    unsigned int width;
+    unsigned int height;
+    unsigned int tiles_across;
+    unsigned int tiles_down;
+    unsigned char *data;
+} TiledImage;
+
+TiledImage *create_tiled_image(Image *image);
+TiledImage *load_tiled_image(char *filename);
+void delete_tiled_image(TiledImage *tiled);
+unsigned char get_tiled_image_intensity(TiledImage *tiled, unsigned int row, unsigned int col);
+void get_tiled_region_sums(TiledImage *tiled, int x, int y, int width, int height, unsigned long long *sum, unsigned long long *sum_sq);
+QTNode *create_quadtree_tiled(TiledImage *tiled, double max_rmse);
+
+#endif // TILED_IMAGE_H
@@ -1,89 +1,405 @@
 
 
 #include "image.h"
+#include "qtree_stats.h"
+#include <limits.h>
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
 
 
-Image *load_image(char *filename)
+static unsigned char *read_file_contents(char *filename, size_t *size)
 {
-    FILE *file = fopen(filename, "r");
+    FILE *file = fopen(filename, "rb");
     if (!file) return NULL;
 
+    if (fseek(file, 0, SEEK_END) != 0)
+    {
+        fclose(file);
+        return NULL;
+    }
+    long length = ftell(file);
+    if (length < 0 || fseek(file, 0, SEEK_SET) != 0)
+    {
+        fclose(file);
+        return NULL;
+    }
 
-    char format[3];
-    fscanf(file, "%2s", format);
-    if (strcmp(format, "P3") != 0)
+    // One extra NUL byte acts as a sentinel so the scanners never need a bounds check.
+    unsigned char *buffer = (unsigned char *)malloc((size_t)length + 1);
+    if (!buffer)
     {
         fclose(file);
         return NULL;
     }
+    if (fread(buffer, 1, (size_t)length, file) != (size_t)length)
+    {
+        free(buffer);
+        fclose(file);
+        return NULL;
+    }
+    buffer[length] = '\0';
+    fclose(file);
+    *size = (size_t)length;
+    return buffer;
+}
 
+static const unsigned char *skip_whitespace(const unsigned char *p)
+{
+    while (*p == ' ' || (*p >= '\t' && *p <= '\r')) p++;
+    return p;
+}
 
-    int ch;
+static const unsigned char *skip_header_whitespace(const unsigned char *p)
+{
+    for (p = skip_whitespace(p); *p == '#'; p = skip_whitespace(p))
+    {
+        while (*p != '\n' && *p != '\0') p++;
+    }
+    return p;
+}
+
+// Parses one decimal number; returns NULL when no digits are present or the number does
+// not fit in an unsigned int.
+static const unsigned char *scan_uint(const unsigned char *p, unsigned int *value)
+{
+    unsigned int result = 0;
+    unsigned int digit = (unsigned int)(*p - '0');
+    if (digit > 9) return NULL;
     do
     {
-        ch = fgetc(file);
-        if (ch == '#') while (fgetc(file) != '\n');
+        if (result > (UINT_MAX - digit) / 10) return NULL;
+        result = result * 10 + digit;
+        digit = (unsigned int)(*++p - '0');
+    }
+    while (digit <= 9);
+    *value = result;
+    return p;
+}
+
+Image *create_image(unsigned int width, unsigned int height, unsigned char channels)
+{
+    Image *image = (Image *)malloc(sizeof(Image));
+    if (!image) return NULL;
+    image->width = width;
+    image->height = height;
+    image->channels = channels;
+    image->data = (unsigned char *)malloc((size_t)channels * width * height);
+    if (!image->data)
+    {
+        free(image);
+        return NULL;
     }
-    while (ch == '#' || ch == '\n');
-    ungetc(ch, file);
+    return image;
+}
 
+// Grayscale images keep only the first sample of every RGB triple. Samples above 255,
+// the only max value accepted, fail the decode.
+static int decode_ascii_pixels(Image *image, const unsigned char *p)
+{
+    size_t pixel_count = (size_t)image->width * image->height;
+    unsigned char *out = image->data;
+    unsigned int value;
+    for (size_t i = 0; i < pixel_count; i++)
+    {
+        for (int channel = 0; channel < 3; channel++)
+        {
+            p = scan_uint(skip_whitespace(p), &value);
+            if (!p || value > 255) return 0;
+            if (channel < image->channels) *out++ = (unsigned char)value;
+        }
+    }
+    return 1;
+}
+
+static int decode_binary_pixels(Image *image, ImageFormat format, const unsigned char *p, size_t available)
+{
+    size_t pixel_count = (size_t)image->width * image->height;
+    unsigned char input_channels = format == IMAGE_FORMAT_P6 ? 3 : 1;
+    if (available < input_channels * pixel_count) return 0;
 
-    unsigned short width, height, max_value;
-    if (fscanf(file, "%hu %hu %hu", &width, &height, &max_value) != 3)
+    if (input_channels == image->channels)
     {
-        fclose(file);
+        memcpy(image->data, p, input_channels * pixel_count);
+    }
+    else if (input_channels == 3)
+    {
+        for (size_t i = 0; i < pixel_count; i++) image->data[i] = p[3 * i];
+    }
+    else
+    {
+        for (size_t i = 0; i < pixel_count; i++)
+        {
+            image->data[3 * i] = image->data[3 * i + 1] = image->data[3 * i + 2] = p[i];
+        }
+    }
+    return 1;
+}
+
+static Image *load_image_channels(char *filename, unsigned char channels)
+{
+    QT_STATS_START(start);
+    size_t size;
+    unsigned char *buffer = read_file_contents(filename, &size);
+    if (!buffer) return NULL;
+    QT_STATS_BYTES((long long)size, 0);
+
+    const unsigned char *p = skip_whitespace(buffer);
+    ImageFormat format;
+    if (p[0] == 'P' && p[1] == '3') format = IMAGE_FORMAT_P3;
+    else if (p[0] == 'P' && p[1] == '5') format = IMAGE_FORMAT_P5;
+    else if (p[0] == 'P' && p[1] == '6') format = IMAGE_FORMAT_P6;
+    else
+    {
+        free(buffer);
         return NULL;
     }
+    p += 2;
 
+    unsigned int width, height, max_value;
+    if (!(p = scan_uint(skip_header_whitespace(p), &width)) ||
+        !(p = scan_uint(skip_header_whitespace(p), &height)) ||
+        !(p = scan_uint(skip_header_whitespace(p), &max_value)) ||
+        width == 0 || height == 0 || width > INT_MAX || height > INT_MAX)
+    {
+        free(buffer);
+        return NULL;
+    }
 
     if (max_value != 255)
     {
-        fclose(file);
+        free(buffer);
         return NULL;
     }
 
-
-    Image *image = (Image *)malloc(sizeof(Image));
+    Image *image = create_image(width, height, channels);
     if (!image)
+    {
+        free(buffer);
+        return NULL;
+    }
+
+    // Binary rasters start after exactly one whitespace byte following the max value.
+    int decoded = format == IMAGE_FORMAT_P3 ? decode_ascii_pixels(image, p)
+                                            : *p != '\0' && decode_binary_pixels(image, format, p + 1, size - (size_t)(p + 1 - buffer));
+    free(buffer);
+    if (!decoded)
+    {
+        delete_image(image);
+        return NULL;
+    }
+    QT_STATS_PHASE(QT_STATS_PARSE, start);
+    return image;
+}
+
+Image *load_image(char *filename)
+{
+    return load_image_channels(filename, 1);
+}
+
+Image *load_image_rgb(char *filename)
+{
+    return load_image_channels(filename, 3);
+}
+
+static int skip_stream_whitespace(FILE *file)
+{
+    int ch = getc(file);
+    while (ch == ' ' || (ch >= '\t' && ch <= '\r') || ch == '#')
+    {
+        if (ch == '#') while (ch != '\n' && ch != EOF) ch = getc(file);
+        ch = getc(file);
+    }
+    return ch;
+}
+
+// Reads one decimal number starting at `ch`; leaves the terminating byte consumed.
+static int scan_stream_uint(FILE *file, int ch, unsigned int *value)
+{
+    if (ch < '0' || ch > '9') return 0;
+    unsigned long long result = 0;
+    while (ch >= '0' && ch <= '9')
+    {
+        result = result * 10 + (unsigned int)(ch - '0');
+        if (result > UINT_MAX) return 0;
+        ch = getc(file);
+    }
+    *value = (unsigned int)result;
+    return 1;
+}
+
+ImageReader *open_image_reader(char *filename)
+{
+    FILE *file = fopen(filename, "rb");
+    if (!file) return NULL;
+
+    ImageFormat format;
+    int ch = skip_stream_whitespace(file);
+    int kind = ch == 'P' ? getc(file) : EOF;
+    if (kind == '3') format = IMAGE_FORMAT_P3;
+    else if (kind == '5') format = IMAGE_FORMAT_P5;
+    else if (kind == '6') format = IMAGE_FORMAT_P6;
+    else
     {
         fclose(file);
         return NULL;
     }
-    image->width = width;
-    image->height = height;
-    image->data = (unsigned char *)malloc(3 * width * height);
-    if (!image->data)
+
+    // The byte after the max value is consumed by the scan, which is exactly the one
+    // whitespace byte that precedes a binary raster.
+    unsigned int width, height, max_value;
+    if (!scan_stream_uint(file, skip_stream_whitespace(file), &width) ||
+        !scan_stream_uint(file, skip_stream_whitespace(file), &height) ||
+        !scan_stream_uint(file, skip_stream_whitespace(file), &max_value) ||
+        max_value != 255 || width == 0 || height == 0 || width > INT_MAX || height > INT_MAX)
     {
-        free(image);
         fclose(file);
         return NULL;
     }
 
+    ImageReader *reader = (ImageReader *)malloc(sizeof(ImageReader));
+    unsigned char *row_buffer = format == IMAGE_FORMAT_P6 ? (unsigned char *)malloc((size_t)3 * width) : NULL;
+    if (!reader || (format == IMAGE_FORMAT_P6 && !row_buffer))
+    {
+        ERROR("Memory allocation failed for ImageReader");
+        free(reader);
+        free(row_buffer);
+        fclose(file);
+        return NULL;
+    }
+    reader->file = file;
+    reader->format = format;
+    reader->width = width;
+    reader->height = height;
+    reader->next_row = 0;
+    reader->row_buffer = row_buffer;
+    return reader;
+}
 
-    unsigned int r, g, b;
-    unsigned int pixel_count = 0;
+// Decodes the next row_count rows as grayscale (first sample of every pixel) into rows.
+int read_image_rows(ImageReader *reader, unsigned char *rows, unsigned int row_count)
+{
+    if (row_count > reader->height - reader->next_row) return 0;
+    size_t width = reader->width;
+    for (unsigned int row = 0; row < row_count; row++)
+    {
+        unsigned char *out = rows + row * width;
+        if (reader->format == IMAGE_FORMAT_P5)
+        {
+            if (fread(out, 1, width, reader->file) != width) return 0;
+        }
+        else if (reader->format == IMAGE_FORMAT_P6)
+        {
+            if (fread(reader->row_buffer, 1, 3 * width, reader->file) != 3 * width) return 0;
+            for (size_t col = 0; col < width; col++) out[col] = reader->row_buffer[3 * col];
+        }
+        else
+        {
+            for (size_t col = 0; col < width; col++)
+            {
+                unsigned int value;
+                for (int channel = 0; channel < 3; channel++)
+                {
+                    if (!scan_stream_uint(reader->file, skip_stream_whitespace(reader->file), &value) || value > 255) return 0;
+                    if (channel == 0) out[col] = (unsigned char)value;
+                }
+            }
+        }
+        reader->next_row++;
+    }
+    return 1;
+}
 
+void close_image_reader(ImageReader *reader)
+{
+    if (reader)
+    {
+        fclose(reader->file);
+        free(reader->row_buffer);
+        free(reader);
+    }
+}
 
-    for (unsigned int i = 0; i < width * height; i++)
+static char *write_decimal(char *out, unsigned char value)
+{
+    if (value >= 100) *out++ = (char)('0' + value / 100);
+    if (value >= 10) *out++ = (char)('0' + value / 10 % 10);
+    *out++ = (char)('0' + value % 10);
+    return out;
+}
+
+// Lays out the whole raster in the target format (P3 text is one "r g b" line per pixel)
+// so the file can be written with a single fwrite.
+static unsigned char *encode_raster(Image *image, ImageFormat format, size_t *length)
+{
+    size_t pixel_count = (size_t)image->width * image->height;
+    unsigned char out_channels = format == IMAGE_FORMAT_P5 ? 1 : 3;
+    size_t capacity = format == IMAGE_FORMAT_P3 ? 12 * pixel_count : out_channels * pixel_count;
+    unsigned char *buffer = (unsigned char *)malloc(capacity ? capacity : 1);
+    if (!buffer) return NULL;
+
+    if (format == IMAGE_FORMAT_P3)
     {
-        if (fscanf(file, "%u %u %u", &r, &g, &b) != 3)
+        char *out = (char *)buffer;
+        for (size_t i = 0; i < pixel_count; i++)
         {
-            free(image->data);
-            free(image);
-            fclose(file);
-            return NULL;
+            const unsigned char *pixel = image->data + i * image->channels;
+            for (int channel = 0; channel < 3; channel++)
+            {
+                out = write_decimal(out, image->channels == 3 ? pixel[channel] : pixel[0]);
+                *out++ = channel < 2 ? ' ' : '\n';
+            }
         }
-        image->data[pixel_count++] = (unsigned char)r;
-        image->data[pixel_count++] = (unsigned char)g;
-        image->data[pixel_count++] = (unsigned char)b;
+        *length = (size_t)(out - (char *)buffer);
     }
+    else if (out_channels == 3)
+    {
+        for (size_t i = 0; i < pixel_count; i++)
+        {
+            buffer[3 * i] = buffer[3 * i + 1] = buffer[3 * i + 2] = image->data[i];
+        }
+        *length = capacity;
+    }
+    else
+    {
+        for (size_t i = 0; i < pixel_count; i++) buffer[i] = image->data[3 * i];
+        *length = capacity;
+    }
+    return buffer;
+}
 
+int save_image(Image *image, char *filename, ImageFormat format)
+{
+    FILE *file = fopen(filename, "wb");
+    if (!file)
+    {
+        ERROR("Failed to open file %s for writing", filename);
+        return 0;
+    }
 
-    fclose(file);
-    return image;
+    QT_STATS_START(start);
+    fprintf(file, "%s\n%u %u\n255\n", format == IMAGE_FORMAT_P3 ? "P3" : format == IMAGE_FORMAT_P5 ? "P5" : "P6", image->width, image->height);
+
+    int ok;
+    unsigned char out_channels = format == IMAGE_FORMAT_P5 ? 1 : 3;
+    if (format != IMAGE_FORMAT_P3 && image->channels == out_channels)
+    {
+        size_t length = (size_t)out_channels * image->width * image->height;
+        ok = fwrite(image->data, 1, length, file) == length;
+    }
+    else
+    {
+        size_t length = 0;
+        unsigned char *buffer = encode_raster(image, format, &length);
+        ok = buffer && fwrite(buffer, 1, length, file) == length;
+        free(buffer);
+    }
+
+    QT_STATS_BYTES(0, ftell(file));
+    if (fclose(file) != 0) ok = 0;
+    QT_STATS_PHASE(QT_STATS_SERIALIZE, start);
+    if (!ok) ERROR("Failed to write image %s", filename);
+    return ok;
 }
 
 
@@ -100,297 +416,205 @@ void delete_image(Image *image)
 unsigned char get_image_intensity(Image *image, unsigned int row, unsigned int col)
 {
     if (!image || row >= image->height || col >= image->width) return 0;
-    return image->data[(row * image->width + col) * 3];
+    return image->data[((size_t)row * image->width + col) * image->channels];
 }
 
 
-unsigned short get_image_width(Image *image)
+unsigned int get_image_width(Image *image)
 {
     return image ? image->width : 0;
 }
 
 
-unsigned short get_image_height(Image *image)
+unsigned int get_image_height(Image *image)
 {
     return image ? image->height : 0;
 }
 
 
-int read_image_header(FILE *file, char *format, unsigned short *width, unsigned short *height, unsigned int *max_color) 
-{
-    if (fscanf(file, "%2s", format) != 1 || format[0] != 'P' || format[1] != '3') return 0;
-    char check;
-    while (fscanf(file, " %c", &check) == 1 && check == '#') 
-    {
-        while (fgetc(file) != '\n');
-    }
-    ungetc(check, file);
-    return fscanf(file, "%hu %hu %u", width, height, max_color) == 3;
-}
+// Stego carriers are loaded as grayscale, so consecutive pixels are consecutive bytes of the plane.
+// A hidden byte occupies the LSBs of 8 consecutive pixels, most significant bit first, so it is
+// moved as one 64-bit word: multiplying by STEGO_SPREAD places bit 7 - k of a byte in the LSB of
+// byte k (and gathers them back into the top byte), with no overlapping partial products.
+#define STEGO_SPREAD 0x8040201008040201ULL
+#define STEGO_LSBS 0x0101010101010101ULL
 
-void encode_message_char(FILE *input, FILE *output, char current_char) 
+static void embed_byte(Image *image, size_t *pixel, unsigned char value)
 {
-    for (int bit_pos = 7; bit_pos >= 0; bit_pos--) 
-    {
-        unsigned int pixel_color;
-        fscanf(input, "%u %*u %*u", &pixel_color);
-        int bit = ((current_char >> bit_pos) & 1);
-        pixel_color = (pixel_color & ~1) | bit;
-        fprintf(output, "%u %u %u ", pixel_color, pixel_color, pixel_color);
-    }
+    unsigned char *samples = image->data + *pixel;
+    *pixel += 8;
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    unsigned long long word;
+    memcpy(&word, samples, sizeof(word));
+    word = (word & ~STEGO_LSBS) | (((unsigned long long)value * STEGO_SPREAD) >> 7 & STEGO_LSBS);
+    memcpy(samples, &word, sizeof(word));
+#else
+    for (int k = 0; k < 8; k++) samples[k] = (unsigned char)((samples[k] & ~1) | ((value >> (7 - k)) & 1));
+#endif
 }
 
-void copy_remaining_pixels(FILE *input, FILE *output) 
+static unsigned char extract_byte(Image *image, size_t *pixel)
 {
-    unsigned int remaining_pixel;
-    while (fscanf(input, "%u %*u %*u", &remaining_pixel) == 1) 
-    {
-        fprintf(output, "%u %u %u ", remaining_pixel, remaining_pixel, remaining_pixel);
-    }
+    const unsigned char *samples = image->data + *pixel;
+    *pixel += 8;
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    unsigned long long word;
+    memcpy(&word, samples, sizeof(word));
+    return (unsigned char)(((word & STEGO_LSBS) * STEGO_SPREAD) >> 56);
+#else
+    unsigned char value = 0;
+    for (int k = 0; k < 8; k++) value = (unsigned char)(value << 1 | (samples[k] & 1));
+    return value;
+#endif
 }
 
-unsigned int hide_message(char *message, char *input_filename, char *output_filename) 
+unsigned int hide_message_format(char *message, char *input_filename, char *output_filename, ImageFormat format)
 {
-    FILE *input = fopen(input_filename, "r");
-    FILE *output = fopen(output_filename, "w");
-    if (!input || !output) 
-    {
-        fclose(input);
-        fclose(output);
-        return 0;
-    }
-
-    char img_format[3];
-    unsigned short img_width, img_height;
-    unsigned int max_color_value;
-
-    if (!read_image_header(input, img_format, &img_width, &img_height, &max_color_value)) 
-    {
-        fclose(input);
-        fclose(output);
-        return 0;
-    }
-
-    fprintf(output, "%c%c\n%hu %hu\n%u\n", img_format[0], img_format[1], img_width, img_height, max_color_value);
+    Image *image = load_image(input_filename);
+    if (!image) return 0;
 
     long unsigned int msg_len = strlen(message);
-    long unsigned int available_space = img_width * img_height;
+    long unsigned int available_space = (long unsigned int)image->width * image->height;
     long unsigned int msg_idx = 0;
+    size_t pixel = 0;
     int encoded_length = 0;
 
-    while (available_space >= 8 && msg_idx <= msg_len) 
+    // The final 8-pixel slot is reserved for the terminator when the message does not fit.
+    while (available_space >= 8 && msg_idx <= msg_len)
     {
-        encoded_length++;
         char current_char = (available_space > 8) ? message[msg_idx] : '\0';
-        if (current_char == '\0') 
+        if (current_char != '\0')
         {
-            encoded_length--;
+            encoded_length++;
         }
-
-        encode_message_char(input, output, current_char);
-
+        embed_byte(image, &pixel, (unsigned char)current_char);
         available_space -= 8;
         msg_idx++;
     }
 
-    copy_remaining_pixels(input, output);
-
-    fclose(input);
-    fclose(output);
-    return encoded_length;
+    int saved = save_image(image, output_filename, format);
+    delete_image(image);
+    return saved ? (unsigned int)encoded_length : 0;
 }
 
-unsigned char extract_character(FILE *input_file) 
+unsigned int hide_message(char *message, char *input_filename, char *output_filename)
 {
-    unsigned char character = 0;
-    for (int bit_pos = 7; bit_pos >= 0; bit_pos--) 
-    {
-        unsigned int pixel_color;
-        fscanf(input_file, "%u %*u %*u", &pixel_color);
-        character |= (pixel_color & 1) << bit_pos;
-    }
-    return character;
+    return hide_message_format(message, input_filename, output_filename, IMAGE_FORMAT_P3);
 }
 
-char *reveal_message(char *input_filename) 
+char *reveal_message(char *input_filename)
 {
-    FILE *input_file = fopen(input_filename, "r");
-    if (!input_file) 
-    {
-        return NULL;
-    }
+    Image *image = load_image(input_filename);
+    if (!image) return NULL;
 
-    char img_format[3];
-    unsigned short img_width, img_height;
-    unsigned int max_color_value;
-
-    if (!read_image_header(input_file, img_format, &img_width, &img_height, &max_color_value)) 
+    // The carrier holds at most one character per 8 pixels, plus the terminator added here.
+    size_t total_count = (size_t)image->width * image->height / 8;
+    char *message = (char *)malloc(total_count + 1);
+    if (!message)
     {
-        fclose(input_file);
+        ERROR("Memory allocation failed for revealed message");
+        delete_image(image);
         return NULL;
     }
 
-    char *message = (char *)malloc(10000000);
-    if (!message) 
+    size_t msg_index = 0;
+    size_t pixel = 0;
+    for (size_t count = 0; count < total_count; count++)
     {
-        fclose(input_file);
-        return NULL;
-    }
-
-    unsigned int msg_index = 0;
-    int pixel_count = img_width * img_height;
-    int total_count = pixel_count / 8;
-    int count = 0;
-
-    while (count < total_count) 
-    {
-        unsigned char character = extract_character(input_file);
-        if (character == '\0') 
+        unsigned char character = extract_byte(image, &pixel);
+        if (character == '\0')
         {
             break;
         }
-        message[msg_index++] = character;
-        count++;
+        message[msg_index++] = (char)character;
     }
     message[msg_index] = '\0';
-    fclose(input_file);
+    delete_image(image);
     return message;
 }
 
-void encode_dimension_bits(FILE *input_file, FILE *output_file, unsigned short dimension) 
+unsigned int hide_image_format(char *secret_image_filename, char *input_filename, char *output_filename, ImageFormat format)
 {
-    for (int bit_pos = 7; bit_pos >= 0; bit_pos--) 
-    {
-        unsigned int bit = (dimension >> bit_pos) & 1;
-        unsigned int pixel_color;
-        fscanf(input_file, "%u %*u %*u", &pixel_color);
-        pixel_color = (pixel_color & ~1) | bit;
-        fprintf(output_file, "%u %u %u ", pixel_color, pixel_color, pixel_color);
-    }
-}
-
-void embed_image(FILE *secret_file, FILE *input_file, FILE *output_file) 
-{
-    unsigned int secret_pixel;
-    while (fscanf(secret_file, "%u %*u %*u", &secret_pixel) == 1) 
-    {
-        for (int bit_pos = 7; bit_pos >= 0; bit_pos--) 
-        {
-            unsigned int bit = (secret_pixel >> bit_pos) & 1;
-            unsigned int input_pixel;
-            fscanf(input_file, "%u %*u %*u", &input_pixel);
-            input_pixel = (input_pixel & ~1) | bit;
-            fprintf(output_file, "%u %u %u ", input_pixel, input_pixel, input_pixel);
-        }
-    }
-}
-unsigned int hide_image(char *secret_image_filename, char *input_filename, char *output_filename) 
-{
-    FILE *secret_file = fopen(secret_image_filename, "r");
-    FILE *input_file = fopen(input_filename, "r");
-    FILE *output_file = fopen(output_filename, "w");
-
-    if (!secret_file || !input_file || !output_file) 
+    Image *secret = load_image(secret_image_filename);
+    Image *image = load_image(input_filename);
+    if (!secret || !image)
     {
-        if (secret_file) fclose(secret_file);
-        if (input_file) fclose(input_file);
-        if (output_file) fclose(output_file);
+        delete_image(secret);
+        delete_image(image);
         return 0;
     }
 
-    char secret_format[3], input_format[3];
-    unsigned short secret_width, secret_height, input_width, input_height;
-    unsigned int secret_max_color, input_max_color;
-
-    if (!read_image_header(secret_file, secret_format, &secret_width, &secret_height, &secret_max_color) ||
-        !read_image_header(input_file, input_format, &input_width, &input_height, &input_max_color)) 
+    unsigned long required_space = ((unsigned long)secret->width * secret->height * 8) + 16;
+    unsigned long available_space = (unsigned long)image->width * image->height;
+    if (required_space > available_space)
     {
-        fclose(secret_file);
-        fclose(input_file);
-        fclose(output_file);
-        return 0;
-    }
-
-    unsigned long required_space = (secret_width * secret_height * 8) + 16;
-    unsigned long available_space = input_width * input_height;
-    if (required_space > available_space) 
-    {
-        fclose(secret_file);
-        fclose(input_file);
-        fclose(output_file);
+        delete_image(secret);
+        delete_image(image);
         printf("Image is not allowed to be hidden!\n");
         return 0;
     }
 
-    fprintf(output_file, "%s\n%hu %hu\n%u\n", "P3", input_width, input_height, 255);
-
-    encode_dimension_bits(input_file, output_file, secret_width);
-    encode_dimension_bits(input_file, output_file, secret_height);
-
-    embed_image(secret_file, input_file, output_file);
-    copy_remaining_pixels(input_file, output_file);
+    // Each dimension is stored in 8 bits, so only its low byte survives.
+    size_t pixel = 0;
+    embed_byte(image, &pixel, (unsigned char)secret->width);
+    embed_byte(image, &pixel, (unsigned char)secret->height);
 
-    fclose(secret_file);
-    fclose(input_file);
-    fclose(output_file);
-    return 1;
-}
-
-unsigned short extract_dimension(FILE *input) 
-{
-    unsigned short dimension = 0;
-    for (int bit_pos = 7; bit_pos >= 0; bit_pos--) 
+    size_t secret_pixels = (size_t)secret->width * secret->height;
+    for (size_t i = 0; i < secret_pixels; i++)
     {
-        unsigned int pixel_val;
-        fscanf(input, "%u %*u %*u", &pixel_val);
-        dimension |= ((pixel_val & 1) << bit_pos);
+        embed_byte(image, &pixel, secret->data[i]);
     }
-    return dimension;
+
+    int saved = save_image(image, output_filename, format);
+    delete_image(secret);
+    delete_image(image);
+    return saved ? 1 : 0;
 }
 
-void extract_hidden_image(FILE *input, FILE *output, int total_pixels) 
+unsigned int hide_image(char *secret_image_filename, char *input_filename, char *output_filename)
 {
-    for (int i = 0; i < total_pixels; i++) 
-    {
-        unsigned int hidden_pixel = 0;
-        for (int bit_pos = 7; bit_pos >= 0; bit_pos--) 
-        {
-            unsigned int pixel_val;
-            fscanf(input, "%u %*u %*u", &pixel_val);
-            hidden_pixel |= ((pixel_val & 1) << bit_pos);
-        }
-        fprintf(output, "%u %u %u ", hidden_pixel, hidden_pixel, hidden_pixel);
-    }
+    return hide_image_format(secret_image_filename, input_filename, output_filename, IMAGE_FORMAT_P3);
 }
 
-void reveal_image(char *input_filename, char *output_filename) 
+void reveal_image_format(char *input_filename, char *output_filename, ImageFormat format)
 {
-    FILE *input = fopen(input_filename, "r");
-    FILE *output = fopen(output_filename, "w");
+    Image *image = load_image(input_filename);
+    if (!image) return;
 
-    if (!input || !output) 
+    size_t available_space = (size_t)image->width * image->height;
+    if (available_space < 16)
     {
-        fclose(input);
-        fclose(output);
+        delete_image(image);
         return;
     }
 
-    char img_format[3];
-    unsigned short img_width, img_height;
-    unsigned int img_max_color;
-
-    if (!read_image_header(input, img_format, &img_width, &img_height, &img_max_color)) 
+    size_t pixel = 0;
+    unsigned int hidden_width = extract_byte(image, &pixel);
+    unsigned int hidden_height = extract_byte(image, &pixel);
+    Image *hidden = create_image(hidden_width, hidden_height, 1);
+    if (!hidden)
     {
-        fclose(input);
-        fclose(output);
+        delete_image(image);
         return;
     }
 
-    unsigned short hidden_width = extract_dimension(input);
-    unsigned short hidden_height = extract_dimension(input);
-    fprintf(output, "%s\n%hu %hu\n%u\n", "P3", hidden_width, hidden_height, 255);
-    int total_pixels = hidden_width * hidden_height;
-    extract_hidden_image(input, output, total_pixels);
-    fclose(input);
-    fclose(output);
-}
\ No newline at end of file
+    size_t total_pixels = (size_t)hidden_width * hidden_height;
+    for (size_t i = 0; i < total_pixels; i++)
+    {
+        unsigned char hidden_pixel = 0;
+        if (pixel + 8 <= available_space)
+        {
+            hidden_pixel = extract_byte(image, &pixel);
+        }
+        hidden->data[i] = hidden_pixel;
+    }
+
+    save_image(hidden, output_filename, format);
+    delete_image(hidden);
+    delete_image(image);
+}
+
+void reveal_image(char *input_filename, char *output_filename)
+{
+    reveal_image_format(input_filename, output_filename, IMAGE_FORMAT_P3);
+}
@@ -0,0 +1,69 @@
+#include "integral_image.h"
+#include <stdlib.h>
+
+IntegralImage *create_integral_image(Image *image)
+{
+    if (!image) return NULL;
+
+    IntegralImage *integral = (IntegralImage *)malloc(sizeof(IntegralImage));
+    if (!integral)
+    {
+        ERROR("Memory allocation failed for IntegralImage");
+        return NULL;
+    }
+    integral->width = image->width;
+    integral->height = image->height;
+
+    size_t stride = (size_t)image->width + 1;
+    size_t entries = stride * ((size_t)image->height + 1);
+    integral->sum = (unsigned long long *)calloc(entries, sizeof(unsigned long long));
+    integral->sum_sq = (unsigned long long *)calloc(entries, sizeof(unsigned long long));
+    if (!integral->sum || !integral->sum_sq)
+    {
+        ERROR("Memory allocation failed for integral image tables");
+        delete_integral_image(integral);
+        return NULL;
+    }
+
+    for (unsigned int row = 0; row < image->height; row++)
+    {
+        unsigned long long row_sum = 0;
+        unsigned long long row_sum_sq = 0;
+        unsigned long long *sum_above = integral->sum + row * stride;
+        unsigned long long *sum_sq_above = integral->sum_sq + row * stride;
+        unsigned long long *sum_out = sum_above + stride;
+        unsigned long long *sum_sq_out = sum_sq_above + stride;
+        const unsigned char *src = image->data + (size_t)row * image->width * image->channels;
+        for (unsigned int col = 0; col < image->width; col++)
+        {
+            unsigned long long intensity = src[(size_t)col * image->channels];
+            row_sum += intensity;
+            row_sum_sq += intensity * intensity;
+            sum_out[col + 1] = sum_above[col + 1] + row_sum;
+            sum_sq_out[col + 1] = sum_sq_above[col + 1] + row_sum_sq;
+        }
+    }
+    return integral;
+}
+
+void delete_integral_image(IntegralImage *integral)
+{
+    if (integral)
+    {
+        free(integral->sum);
+        free(integral->sum_sq);
+        free(integral);
+    }
+}
+
+void get_integral_region(IntegralImage *integral, int x, int y, int width, int height, unsigned long long *sum, unsigned long long *sum_sq)
+{
+    size_t stride = (size_t)integral->width + 1;
+    size_t top = (size_t)y * stride;
+    size_t bottom = (size_t)(y + height) * stride;
+    size_t left = (size_t)x;
+    size_t right = (size_t)(x + width);
+
+    *sum = integral->sum[bottom + right] - integral->sum[top + right] - integral->sum[bottom + left] + integral->sum[top + left];
+    *sum_sq = integral->sum_sq[bottom + right] - integral->sum_sq[top + right] - integral->sum_sq[bottom + left] + integral->sum_sq[top + left];
+}
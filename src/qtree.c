@@ -1,88 +1,258 @@
+#include <limits.h>
 #include <math.h>
 #include <stdlib.h>
+#include <string.h>
 #include "image.h"
 #include "qtree.h"
+#include "integral_image.h"
+#include "region_sums.h"
+#include "qtree_arena.h"
+#include "qtree_stats.h"
 #include <stdio.h>
 
+// Smallest region whose scan may stop early; below it the per-row check costs more than
+// the rows it could skip.
+#define QT_EARLY_SPLIT_PIXELS 256
+
+// Squared error around the truncated mean m, expanded as
+// sum((v - m)^2) = sum_sq - 2 * m * sum + m^2 * n and evaluated exactly in integers,
+// so it is bit-identical to summing pow(v - m, 2) in doubles pixel by pixel.
+static double rmse_from_sums(unsigned long long sum, unsigned long long sum_sq, unsigned long long pixel_count, unsigned long long average)
+{
+    unsigned long long squared_error = sum_sq - 2 * average * sum + average * average * pixel_count;
+    return pixel_count ? sqrt((double)squared_error / (double)pixel_count) : 0.0;
+}
+
 double calculate_rmse(Image *image, int x, int y, int width, int height, unsigned char avg_intensity) 
 {
-    double rmse = 0.0;
-    int pixel_count = width * height;
-    for (int i = y; i < y + height; i++) 
-    {
-        for (int j = x; j < x + width; j++) 
-        {
-            unsigned char intensity = get_image_intensity(image, i, j);
-            rmse += pow(intensity - avg_intensity, 2);
-        }
-    }
-    return sqrt(rmse / pixel_count);
+    unsigned long long sum, sum_sq;
+    get_image_region_sums(image, x, y, width, height, &sum, &sum_sq);
+    return rmse_from_sums(sum, sum_sq, (unsigned long long)width * height, avg_intensity);
 }
 
-QTNode *create_quadtree_recursive(Image *image, int x, int y, int width, int height, double max_rmse) 
+static QTNode *alloc_qtnode(QTArena *arena)
 {
-    QTNode *node = (QTNode *)malloc(sizeof(QTNode));
+    return arena ? qt_arena_alloc_node(arena) : (QTNode *)malloc(sizeof(QTNode));
+}
+
+// A region's truncated mean and the RMSE around it, from its intensity sum and sum of squares.
+double calculate_qt_region_rmse(QTRegion region, unsigned long long sum, unsigned long long sum_sq, unsigned char *intensity)
+{
+    unsigned long long pixel_count = (unsigned long long)region.width * region.height;
+    unsigned long long average = pixel_count ? sum / pixel_count : 0;
+    *intensity = (unsigned char)average;
+    return rmse_from_sums(sum, sum_sq, pixel_count, average);
+}
+
+// The leaf decision from a region's intensity sum and sum of squares, however obtained.
+int evaluate_qt_region_sums(QTRegion region, unsigned long long sum, unsigned long long sum_sq, double max_rmse, unsigned char *intensity)
+{
+    double rmse = calculate_qt_region_rmse(region, sum, sum_sq, intensity);
+    return rmse <= max_rmse || (region.width <= 1 && region.height <= 1);
+}
+
+// Computes a region's truncated mean and reports whether it should become a leaf.
+// Sum and sum of squares come from one vectorized pass over the region's rows.
+int evaluate_qt_region(Image *image, QTRegion region, double max_rmse, unsigned char *intensity)
+{
+    unsigned long long sum, sum_sq;
+    get_image_region_sums(image, region.col, region.row, region.width, region.height, &sum, &sum_sq);
+    return evaluate_qt_region_sums(region, sum, sum_sq, max_rmse, intensity);
+}
+
+// The smallest squared error whose RMSE over pixel_count pixels exceeds max_rmse as
+// rmse_from_sums rounds it, or ULLONG_MAX when no squared error can.
+static unsigned long long calculate_split_error(unsigned long long pixel_count, double max_rmse)
+{
+    if (!(max_rmse >= 0)) return max_rmse < 0 ? 0 : ULLONG_MAX;
+    double limit = max_rmse * max_rmse * (double)pixel_count;
+    if (limit >= 65025.0 * (double)pixel_count) return ULLONG_MAX;
+    unsigned long long error = (unsigned long long)limit;
+    while (error > 0 && sqrt((double)(error - 1) / (double)pixel_count) > max_rmse) error--;
+    while (!(sqrt((double)error / (double)pixel_count) > max_rmse)) error++;
+    return error;
+}
+
+// Whether every child the split of a width x height region calls for was built.
+static int has_all_children(QTNode *node, int width, int height)
+{
+    if (height == 1) return node->children[0] && node->children[1];
+    if (width == 1) return node->children[0] && node->children[2];
+    return node->children[0] && node->children[1] && node->children[2] && node->children[3];
+}
+
+// Builds a region's subtree and reports its intensity sum. Regions of at least
+// QT_EARLY_SPLIT_PIXELS stop scanning once their first rows prove the RMSE is over
+// max_rmse; such a node splits without its full sums and takes its mean from the sum of
+// its children's, which cover the same pixels. The tree is the same as with full scans.
+// Returns NULL if any node cannot be allocated; malloc'd nodes built so far are freed,
+// arena nodes are left to the arena.
+QTNode *create_quadtree_recursive(Image *image, int x, int y, int width, int height, double max_rmse, QTArena *arena, unsigned long long *region_sum)
+{
+    QTNode *node = alloc_qtnode(arena);
     if (!node) 
     {
         ERROR("Memory allocation failed for QTNode");
+        *region_sum = 0;
         return NULL;
     }
-    double total_intensity = 0.0;
-    int pixel_count = width * height;
-    for (int i = y; i < y + height; i++) 
+
+    QTRegion region = {y, x, width, height};
+    unsigned long long pixel_count = (unsigned long long)width * height;
+    unsigned long long sum, sum_sq;
+    int scanned = 1;
+    if (pixel_count >= QT_EARLY_SPLIT_PIXELS)
     {
-        for (int j = x; j < x + width; j++) 
-        {
-            total_intensity += get_image_intensity(image, i, j);
-        }
+        scanned = get_image_region_sums_bounded(image, x, y, width, height, calculate_split_error(pixel_count, max_rmse), &sum, &sum_sq);
     }
-    double average_intensity = total_intensity / pixel_count;
-    node->intensity = (unsigned char)average_intensity;
-
-    double rmse = calculate_rmse(image, x, y, width, height, average_intensity);
-
-    if (rmse <= max_rmse || (width <= 1 && height <= 1)) 
+    else
+    {
+        get_image_region_sums(image, x, y, width, height, &sum, &sum_sq);
+    }
+    if (scanned && evaluate_qt_region_sums(region, sum, sum_sq, max_rmse, &node->intensity)) 
     {
         node->is_leaf = 1;
         for (int i = 0; i < 4; i++) node->children[i] = NULL;
         node->width = width;
         node->height = height;
+        *region_sum = sum;
         return node;
     }
 
     node->is_leaf = 0;
     int half_width = width / 2;
     int half_height = height / 2;
+    unsigned long long child_sums[4] = {0, 0, 0, 0};
 
     if (height == 1) 
     {
-        node->children[0] = create_quadtree_recursive(image, x, y, half_width, height, max_rmse);
-        node->children[1] = create_quadtree_recursive(image, x + half_width, y, width - half_width, height, max_rmse);
+        node->children[0] = create_quadtree_recursive(image, x, y, half_width, height, max_rmse, arena, &child_sums[0]);
+        node->children[1] = create_quadtree_recursive(image, x + half_width, y, width - half_width, height, max_rmse, arena, &child_sums[1]);
         node->children[2] = NULL;
         node->children[3] = NULL;
     } 
     else if (width == 1) 
     {
-        node->children[0] = create_quadtree_recursive(image, x, y, width, half_height, max_rmse);
-        node->children[2] = create_quadtree_recursive(image, x, y + half_height, width, height - half_height, max_rmse);
+        node->children[0] = create_quadtree_recursive(image, x, y, width, half_height, max_rmse, arena, &child_sums[0]);
+        node->children[2] = create_quadtree_recursive(image, x, y + half_height, width, height - half_height, max_rmse, arena, &child_sums[2]);
         node->children[1] = NULL;
         node->children[3] = NULL;
     } 
     else 
     {
-        node->children[0] = create_quadtree_recursive(image, x, y, half_width, half_height, max_rmse);
-        node->children[1] = create_quadtree_recursive(image, x + half_width, y, width - half_width, half_height, max_rmse);
-        node->children[2] = create_quadtree_recursive(image, x, y + half_height, half_width, height - half_height, max_rmse);
-        node->children[3] = create_quadtree_recursive(image, x + half_width, y + half_height, width - half_width, height - half_height, max_rmse);
+        node->children[0] = create_quadtree_recursive(image, x, y, half_width, half_height, max_rmse, arena, &child_sums[0]);
+        node->children[1] = create_quadtree_recursive(image, x + half_width, y, width - half_width, half_height, max_rmse, arena, &child_sums[1]);
+        node->children[2] = create_quadtree_recursive(image, x, y + half_height, half_width, height - half_height, max_rmse, arena, &child_sums[2]);
+        node->children[3] = create_quadtree_recursive(image, x + half_width, y + half_height, width - half_width, height - half_height, max_rmse, arena, &child_sums[3]);
+    }
+    if (!has_all_children(node, width, height))
+    {
+        if (!arena) delete_quadtree(node);
+        *region_sum = 0;
+        return NULL;
+    }
+    if (!scanned)
+    {
+        sum = child_sums[0] + child_sums[1] + child_sums[2] + child_sums[3];
+        node->intensity = (unsigned char)(sum / pixel_count);
     }
     node->width = width;
     node->height = height;
+    *region_sum = sum;
     return node;
 }
 
 QTNode *create_quadtree(Image *image, double max_rmse) 
 {
-    return create_quadtree_recursive(image, 0, 0, image->width, image->height, max_rmse);
+    QT_STATS_START(start);
+    unsigned long long sum;
+    QTNode *root = create_quadtree_recursive(image, 0, 0, image->width, image->height, max_rmse, NULL, &sum);
+    QT_STATS_PHASE(QT_STATS_BUILD, start);
+    QT_STATS_TREE(root);
+    return root;
+}
+
+// Builds the subtree of one region of the image; returns NULL, having freed whatever it
+// built, when a node cannot be allocated.
+QTNode *create_quadtree_region(Image *image, QTRegion region, double max_rmse)
+{
+    unsigned long long sum;
+    return create_quadtree_recursive(image, region.col, region.row, region.width, region.height, max_rmse, NULL, &sum);
+}
+
+QTNode *create_quadtree_arena(QTArena *arena, Image *image, double max_rmse)
+{
+    QT_STATS_START(start);
+    unsigned long long sum;
+    QTNode *root = create_quadtree_recursive(image, 0, 0, image->width, image->height, max_rmse, arena, &sum);
+    QT_STATS_PHASE(QT_STATS_BUILD, start);
+    QT_STATS_TREE(root);
+    return root;
+}
+
+static QTNode *create_quadtree_sat_recursive(IntegralImage *integral, int x, int y, int width, int height, double max_rmse)
+{
+    QTNode *node = (QTNode *)malloc(sizeof(QTNode));
+    if (!node)
+    {
+        ERROR("Memory allocation failed for QTNode");
+        return NULL;
+    }
+
+    // Same decision as evaluate_qt_region, with the sums from four table lookups.
+    unsigned long long sum, sum_sq;
+    get_integral_region(integral, x, y, width, height, &sum, &sum_sq);
+    QTRegion region = {y, x, width, height};
+
+    if (evaluate_qt_region_sums(region, sum, sum_sq, max_rmse, &node->intensity))
+    {
+        node->is_leaf = 1;
+        for (int i = 0; i < 4; i++) node->children[i] = NULL;
+        node->width = width;
+        node->height = height;
+        return node;
+    }
+
+    node->is_leaf = 0;
+    int half_width = width / 2;
+    int half_height = height / 2;
+
+    if (height == 1)
+    {
+        node->children[0] = create_quadtree_sat_recursive(integral, x, y, half_width, height, max_rmse);
+        node->children[1] = create_quadtree_sat_recursive(integral, x + half_width, y, width - half_width, height, max_rmse);
+        node->children[2] = NULL;
+        node->children[3] = NULL;
+    }
+    else if (width == 1)
+    {
+        node->children[0] = create_quadtree_sat_recursive(integral, x, y, width, half_height, max_rmse);
+        node->children[2] = create_quadtree_sat_recursive(integral, x, y + half_height, width, height - half_height, max_rmse);
+        node->children[1] = NULL;
+        node->children[3] = NULL;
+    }
+    else
+    {
+        node->children[0] = create_quadtree_sat_recursive(integral, x, y, half_width, half_height, max_rmse);
+        node->children[1] = create_quadtree_sat_recursive(integral, x + half_width, y, width - half_width, half_height, max_rmse);
+        node->children[2] = create_quadtree_sat_recursive(integral, x, y + half_height, half_width, height - half_height, max_rmse);
+        node->children[3] = create_quadtree_sat_recursive(integral, x + half_width, y + half_height, width - half_width, height - half_height, max_rmse);
+    }
+    node->width = width;
+    node->height = height;
+    return node;
+}
+
+QTNode *create_quadtree_sat(Image *image, double max_rmse)
+{
+    QT_STATS_START(start);
+    IntegralImage *integral = create_integral_image(image);
+    if (!integral) return NULL;
+    QTNode *root = create_quadtree_sat_recursive(integral, 0, 0, image->width, image->height, max_rmse);
+    delete_integral_image(integral);
+    QT_STATS_PHASE(QT_STATS_BUILD, start);
+    QT_STATS_TREE(root);
+    return root;
 }
 
 void delete_quadtree(QTNode *root) 
@@ -120,7 +290,37 @@ unsigned char get_node_intensity(QTNode *node)
     return node ? node->intensity : 0; 
 }
 
-static QTNode *load_preorder_qt_helper(FILE *file) 
+// Child regions use the same slots as QTNode::children; unused slots get a 0x0 region.
+int split_qt_region(QTRegion region, QTRegion children[4])
+{
+    int half_width = region.width / 2;
+    int half_height = region.height / 2;
+    for (int i = 0; i < 4; i++) children[i] = (QTRegion){region.row, region.col, 0, 0};
+
+    if (region.width > 1 && region.height > 1)
+    {
+        children[0] = (QTRegion){region.row, region.col, half_width, half_height};
+        children[1] = (QTRegion){region.row, region.col + half_width, region.width - half_width, half_height};
+        children[2] = (QTRegion){region.row + half_height, region.col, half_width, region.height - half_height};
+        children[3] = (QTRegion){region.row + half_height, region.col + half_width, region.width - half_width, region.height - half_height};
+        return 4;
+    }
+    if (region.width > 1)
+    {
+        children[0] = (QTRegion){region.row, region.col, half_width, region.height};
+        children[1] = (QTRegion){region.row, region.col + half_width, region.width - half_width, region.height};
+        return 2;
+    }
+    if (region.height > 1)
+    {
+        children[0] = (QTRegion){region.row, region.col, region.width, half_height};
+        children[2] = (QTRegion){region.row + half_height, region.col, region.width, region.height - half_height};
+        return 2;
+    }
+    return 0;
+}
+
+static QTNode *load_preorder_qt_helper(FILE *file, QTArena *arena) 
 {
     char node_type;
     int intensity, row, height, col, width;
@@ -130,7 +330,7 @@ static QTNode *load_preorder_qt_helper(FILE *file)
         return NULL;
     }
 
-    QTNode *node = (QTNode *)malloc(sizeof(QTNode));
+    QTNode *node = alloc_qtnode(arena);
     if (!node) 
     {
         ERROR("Memory allocation failed for QTNode.");
@@ -153,26 +353,29 @@ static QTNode *load_preorder_qt_helper(FILE *file)
         {
             for (int i = 0; i < 4; i++) 
             {
-                node->children[i] = load_preorder_qt_helper(file);
+                node->children[i] = load_preorder_qt_helper(file, arena);
                 if (!node->children[i]) 
                 {
-                    for (int j = 0; j < i; j++) free(node->children[j]);
-                    free(node);
+                    if (!arena)
+                    {
+                        for (int j = 0; j < i; j++) free(node->children[j]);
+                        free(node);
+                    }
                     return NULL;
                 }
             }
         } 
         else if (width > 1)
         {
-            node->children[0] = load_preorder_qt_helper(file);
-            node->children[1] = load_preorder_qt_helper(file);
+            node->children[0] = load_preorder_qt_helper(file, arena);
+            node->children[1] = load_preorder_qt_helper(file, arena);
             node->children[2] = NULL;
             node->children[3] = NULL;
         } 
         else 
         {
-            node->children[0] = load_preorder_qt_helper(file);
-            node->children[2] = load_preorder_qt_helper(file);
+            node->children[0] = load_preorder_qt_helper(file, arena);
+            node->children[2] = load_preorder_qt_helper(file, arena);
             node->children[1] = NULL;
             node->children[3] = NULL;
         }
@@ -180,14 +383,17 @@ static QTNode *load_preorder_qt_helper(FILE *file)
     return node;
 }
 
-QTNode *load_preorder_qt(char *filename) 
+static QTNode *load_preorder_qt_file(char *filename, QTArena *arena)
 {
     FILE *file = fopen(filename, "r");
     if (!file) 
     {
         return NULL;
     }
-    QTNode *root = load_preorder_qt_helper(file);
+    QT_STATS_START(start);
+    QTNode *root = load_preorder_qt_helper(file, arena);
+    QT_STATS_BYTES(ftell(file), 0);
+    QT_STATS_PHASE(QT_STATS_PARSE, start);
     fclose(file);
     if (!root) 
     {
@@ -196,6 +402,16 @@ QTNode *load_preorder_qt(char *filename)
     return root;
 }
 
+QTNode *load_preorder_qt(char *filename)
+{
+    return load_preorder_qt_file(filename, NULL);
+}
+
+QTNode *load_preorder_qt_arena(QTArena *arena, char *filename)
+{
+    return load_preorder_qt_file(filename, arena);
+}
+
 static void save_preorder_qt_helper(QTNode *node, FILE *file, int row, int col, int width, int height)
 {
     if (!node) return;
@@ -233,51 +449,75 @@ static void save_preorder_qt_helper(QTNode *node, FILE *file, int row, int col,
 }
 
 
-void save_preorder_qt(QTNode *root, char *filename)
+// Returns 1 once the whole file is written and closed, 0 otherwise.
+int save_preorder_qt(QTNode *root, char *filename)
 {
     FILE *file = fopen(filename, "w");
     if (!file)
     {
         ERROR("Failed to open file for writing.");
-        return;
+        return 0;
     }
+    QT_STATS_START(start);
     save_preorder_qt_helper(root, file, 0, 0, root->width, root->height);
-    fclose(file);
+    QT_STATS_BYTES(0, ftell(file));
+    int ok = !ferror(file);
+    if (fclose(file) != 0) ok = 0;
+    QT_STATS_PHASE(QT_STATS_SERIALIZE, start);
+    if (!ok) ERROR("Failed to write quadtree %s", filename);
+    return ok;
 }
 
-void save_qtree_as_ppm_helper(QTNode *node, FILE *file) 
+static void render_quadtree_helper(QTNode *node, QTRegion region, unsigned char *pixels, int stride)
 {
-    if (node == NULL) 
-    {
-        return;
-    }
+    if (!node) return;
 
     if (node->is_leaf)
     {
-        for (int i = 0; i < node->width * node->height; i++) 
+        for (int row = region.row; row < region.row + region.height; row++)
         {
-            fprintf(file, "%hhu %hhu %hhu ", node->intensity, node->intensity, node->intensity);
+            memset(pixels + (size_t)row * stride + region.col, node->intensity, (size_t)region.width);
         }
-    } 
-    else 
+        return;
+    }
+
+    QTRegion children[4];
+    split_qt_region(region, children);
+    for (int i = 0; i < 4; i++)
     {
-       for (int i = 0; i < 4; i++) 
-        {
-            save_qtree_as_ppm_helper(node->children[i], file);
-        }
+        if (children[i].width > 0) render_quadtree_helper(node->children[i], children[i], pixels, stride);
     }
 }
 
-void save_qtree_as_ppm(QTNode *root, char *filename) 
+// Returns a width x height grayscale raster of the tree's leaves.
+unsigned char *render_quadtree(QTNode *root)
 {
-    FILE *file = fopen(filename, "w");
-    if (file == NULL) 
+    if (!root) return NULL;
+    QT_STATS_START(start);
+    unsigned char *pixels = (unsigned char *)calloc((size_t)root->width * root->height, 1);
+    if (!pixels)
     {
-        ERROR("Failed to open file %s for writing", filename);
-        return;
+        ERROR("Memory allocation failed for rendered quadtree");
+        return NULL;
     }
+    QTRegion region = {0, 0, root->width, root->height};
+    render_quadtree_helper(root, region, pixels, root->width);
+    QT_STATS_PHASE(QT_STATS_RENDER, start);
+    return pixels;
+}
 
-    fprintf(file, "P3\n%d %d\n255\n", root->width, root->height);
-    save_qtree_as_ppm_helper(root, file);
-    fclose(file);
-}
\ No newline at end of file
+// Returns 1 once the rendered image is written, 0 otherwise.
+int save_qtree_as_ppm_format(QTNode *root, char *filename, ImageFormat format)
+{
+    unsigned char *pixels = render_quadtree(root);
+    if (!pixels) return 0;
+    Image image = {(unsigned int)root->width, (unsigned int)root->height, 1, pixels};
+    int ok = save_image(&image, filename, format);
+    free(pixels);
+    return ok;
+}
+
+int save_qtree_as_ppm(QTNode *root, char *filename)
+{
+    return save_qtree_as_ppm_format(root, filename, IMAGE_FORMAT_P3);
+}
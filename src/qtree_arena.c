@@ -0,0 +1,70 @@
+#include "qtree_arena.h"
+#include <stdlib.h>
+
+#define QT_ARENA_MIN_BLOCK_NODES 1024
+#define QT_ARENA_MAX_BLOCK_NODES (1 << 20)
+
+QTArena *create_qt_arena(size_t initial_nodes)
+{
+    QTArena *arena = (QTArena *)malloc(sizeof(QTArena));
+    if (!arena)
+    {
+        ERROR("Memory allocation failed for QTArena");
+        return NULL;
+    }
+    arena->blocks = NULL;
+    arena->next_capacity = initial_nodes > QT_ARENA_MIN_BLOCK_NODES ? initial_nodes : QT_ARENA_MIN_BLOCK_NODES;
+    arena->node_count = 0;
+    return arena;
+}
+
+QTNode *qt_arena_alloc_node(QTArena *arena)
+{
+    QTArenaBlock *block = arena->blocks;
+    if (!block || block->used == block->capacity)
+    {
+        size_t capacity = arena->next_capacity;
+        block = (QTArenaBlock *)malloc(sizeof(QTArenaBlock) + capacity * sizeof(QTNode));
+        if (!block)
+        {
+            ERROR("Memory allocation failed for QTArena block");
+            return NULL;
+        }
+        block->next = arena->blocks;
+        block->used = 0;
+        block->capacity = capacity;
+        arena->blocks = block;
+        if (capacity < QT_ARENA_MAX_BLOCK_NODES) arena->next_capacity = capacity * 2;
+    }
+    arena->node_count++;
+    return &block->nodes[block->used++];
+}
+
+// Keeps the most recent (largest) block so a rebuild of a similar tree reuses its memory.
+void reset_qt_arena(QTArena *arena)
+{
+    if (!arena || !arena->blocks) return;
+    QTArenaBlock *block = arena->blocks->next;
+    while (block)
+    {
+        QTArenaBlock *next = block->next;
+        free(block);
+        block = next;
+    }
+    arena->blocks->next = NULL;
+    arena->blocks->used = 0;
+    arena->node_count = 0;
+}
+
+void delete_qt_arena(QTArena *arena)
+{
+    if (!arena) return;
+    QTArenaBlock *block = arena->blocks;
+    while (block)
+    {
+        QTArenaBlock *next = block->next;
+        free(block);
+        block = next;
+    }
+    free(arena);
+}
@@ -0,0 +1,383 @@
+#include <pthread.h>
+#include <string.h>
+#include <time.h>
+#include "qtree_batch.h"
+
+typedef struct QTBatchItem
+{
+    size_t index;
+    Image *image;
+    QTNode *root;
+} QTBatchItem;
+
+// A bounded ring of items. Consumers see the end of the stream once every producer has
+// finished and the ring is empty.
+typedef struct QTBatchQueue
+{
+    QTBatchItem **items;
+    size_t capacity;
+    size_t head;
+    size_t count;
+    int producers;
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+} QTBatchQueue;
+
+typedef struct QTBatch
+{
+    char **input_files;
+    size_t input_count;
+    size_t next_input;
+    QTBatchOptions *options;
+    QTBatchQueue queues[2]; // load -> build, build -> save
+    QTBatchStageStats stages[QT_BATCH_STAGE_COUNT];
+    pthread_mutex_t lock;
+} QTBatch;
+
+static double batch_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static int init_batch_queue(QTBatchQueue *queue, size_t capacity, int producers)
+{
+    queue->items = (QTBatchItem **)malloc(capacity * sizeof(QTBatchItem *));
+    if (!queue->items) return 0;
+    queue->capacity = capacity;
+    queue->head = 0;
+    queue->count = 0;
+    queue->producers = producers;
+    pthread_mutex_init(&queue->lock, NULL);
+    pthread_cond_init(&queue->not_empty, NULL);
+    pthread_cond_init(&queue->not_full, NULL);
+    return 1;
+}
+
+static void destroy_batch_queue(QTBatchQueue *queue)
+{
+    free(queue->items);
+    pthread_mutex_destroy(&queue->lock);
+    pthread_cond_destroy(&queue->not_empty);
+    pthread_cond_destroy(&queue->not_full);
+}
+
+static void push_batch_item(QTBatchQueue *queue, QTBatchItem *item, double *blocked_seconds)
+{
+    pthread_mutex_lock(&queue->lock);
+    if (queue->count == queue->capacity)
+    {
+        double start = batch_now();
+        while (queue->count == queue->capacity) pthread_cond_wait(&queue->not_full, &queue->lock);
+        *blocked_seconds += batch_now() - start;
+    }
+    queue->items[(queue->head + queue->count) % queue->capacity] = item;
+    queue->count++;
+    pthread_cond_signal(&queue->not_empty);
+    pthread_mutex_unlock(&queue->lock);
+}
+
+// Returns NULL once the queue is drained and has no producers left.
+static QTBatchItem *pop_batch_item(QTBatchQueue *queue, double *starved_seconds)
+{
+    pthread_mutex_lock(&queue->lock);
+    if (queue->count == 0 && queue->producers > 0)
+    {
+        double start = batch_now();
+        while (queue->count == 0 && queue->producers > 0) pthread_cond_wait(&queue->not_empty, &queue->lock);
+        *starved_seconds += batch_now() - start;
+    }
+    QTBatchItem *item = NULL;
+    if (queue->count > 0)
+    {
+        item = queue->items[queue->head];
+        queue->head = (queue->head + 1) % queue->capacity;
+        queue->count--;
+        pthread_cond_signal(&queue->not_full);
+    }
+    pthread_mutex_unlock(&queue->lock);
+    return item;
+}
+
+static void finish_batch_producer(QTBatchQueue *queue)
+{
+    pthread_mutex_lock(&queue->lock);
+    if (--queue->producers == 0) pthread_cond_broadcast(&queue->not_empty);
+    pthread_mutex_unlock(&queue->lock);
+}
+
+static void delete_batch_item(QTBatchItem *item)
+{
+    delete_image(item->image);
+    delete_quadtree(item->root);
+    free(item);
+}
+
+static void merge_stage_stats(QTBatch *batch, QTBatchStageKind stage, QTBatchStageStats *worker)
+{
+    pthread_mutex_lock(&batch->lock);
+    QTBatchStageStats *total = &batch->stages[stage];
+    total->items += worker->items;
+    total->failures += worker->failures;
+    total->busy_seconds += worker->busy_seconds;
+    total->starved_seconds += worker->starved_seconds;
+    total->blocked_seconds += worker->blocked_seconds;
+    pthread_mutex_unlock(&batch->lock);
+}
+
+static void *load_worker(void *arg)
+{
+    QTBatch *batch = (QTBatch *)arg;
+    QTBatchStageStats stats = {0, 0, 0, 0, 0, 0};
+    while (1)
+    {
+        pthread_mutex_lock(&batch->lock);
+        size_t index = batch->next_input < batch->input_count ? batch->next_input++ : batch->input_count;
+        pthread_mutex_unlock(&batch->lock);
+        if (index == batch->input_count) break;
+
+        double start = batch_now();
+        QTBatchItem *item = (QTBatchItem *)malloc(sizeof(QTBatchItem));
+        Image *image = item ? load_image(batch->input_files[index]) : NULL;
+        stats.busy_seconds += batch_now() - start;
+        if (!image)
+        {
+            ERROR("Failed to load %s", batch->input_files[index]);
+            free(item);
+            stats.failures++;
+            continue;
+        }
+        item->index = index;
+        item->image = image;
+        item->root = NULL;
+        stats.items++;
+        push_batch_item(&batch->queues[0], item, &stats.blocked_seconds);
+    }
+    finish_batch_producer(&batch->queues[0]);
+    merge_stage_stats(batch, QT_BATCH_LOAD, &stats);
+    return NULL;
+}
+
+static void *build_worker(void *arg)
+{
+    QTBatch *batch = (QTBatch *)arg;
+    QTBatchStageStats stats = {0, 0, 0, 0, 0, 0};
+    QTBatchItem *item;
+    while ((item = pop_batch_item(&batch->queues[0], &stats.starved_seconds)) != NULL)
+    {
+        double start = batch_now();
+        item->root = create_quadtree(item->image, batch->options->max_rmse);
+        delete_image(item->image);
+        item->image = NULL;
+        stats.busy_seconds += batch_now() - start;
+        if (!item->root)
+        {
+            ERROR("Failed to build a quadtree for %s", batch->input_files[item->index]);
+            delete_batch_item(item);
+            stats.failures++;
+            continue;
+        }
+        stats.items++;
+        push_batch_item(&batch->queues[1], item, &stats.blocked_seconds);
+    }
+    finish_batch_producer(&batch->queues[1]);
+    merge_stage_stats(batch, QT_BATCH_BUILD, &stats);
+    return NULL;
+}
+
+static void *save_worker(void *arg)
+{
+    QTBatch *batch = (QTBatch *)arg;
+    QTBatchStageStats stats = {0, 0, 0, 0, 0, 0};
+    QTBatchItem *item;
+    char path[4096];
+    while ((item = pop_batch_item(&batch->queues[1], &stats.starved_seconds)) != NULL)
+    {
+        double start = batch_now();
+        if (get_qt_batch_output_path(batch->input_files[item->index], batch->options, path, sizeof(path)))
+        {
+            int saved = batch->options->output == QT_BATCH_PREORDER ? save_preorder_qt(item->root, path)
+                                                                     : save_qtree_as_ppm_format(item->root, path, batch->options->format);
+            if (saved) stats.items++;
+            else stats.failures++;
+        }
+        else
+        {
+            ERROR("Output path too long for %s", batch->input_files[item->index]);
+            stats.failures++;
+        }
+        delete_batch_item(item);
+        stats.busy_seconds += batch_now() - start;
+    }
+    merge_stage_stats(batch, QT_BATCH_SAVE, &stats);
+    return NULL;
+}
+
+void init_qt_batch_options(QTBatchOptions *options, double max_rmse, QTBatchOutput output, char *output_directory)
+{
+    options->max_rmse = max_rmse;
+    options->output = output;
+    options->format = IMAGE_FORMAT_P3;
+    options->output_directory = output_directory;
+    for (int i = 0; i < QT_BATCH_STAGE_COUNT; i++) options->workers[i] = 1;
+    options->queue_capacity = QT_BATCH_DEFAULT_QUEUE_CAPACITY;
+}
+
+// "<output_directory>/<input base name without extension>.txt" or ".ppm".
+int get_qt_batch_output_path(char *input_file, QTBatchOptions *options, char *path, size_t path_size)
+{
+    const char *base = strrchr(input_file, '/');
+    base = base ? base + 1 : input_file;
+    const char *dot = strrchr(base, '.');
+    int stem_length = (int)(dot && dot != base ? (size_t)(dot - base) : strlen(base));
+    int length = snprintf(path, path_size, "%s/%.*s%s", options->output_directory, stem_length, base,
+                          options->output == QT_BATCH_PREORDER ? ".txt" : ".ppm");
+    return length >= 0 && (size_t)length < path_size;
+}
+
+const char *qt_batch_stage_name(QTBatchStageKind stage)
+{
+    switch (stage)
+    {
+        case QT_BATCH_LOAD: return "load";
+        case QT_BATCH_BUILD: return "build";
+        case QT_BATCH_SAVE: return "save";
+        default: return "unknown";
+    }
+}
+
+typedef struct QTBatchOutputName
+{
+    char *path;
+    size_t index;
+} QTBatchOutputName;
+
+static int compare_output_names(const void *a, const void *b)
+{
+    const QTBatchOutputName *x = (const QTBatchOutputName *)a, *y = (const QTBatchOutputName *)b;
+    int order = strcmp(x->path, y->path);
+    return order ? order : (x->index > y->index) - (x->index < y->index);
+}
+
+// Inputs with the same stem in different directories map to the same output file, and
+// the later save would silently replace the earlier one. Returns 0, naming the first such
+// pair, if any two inputs collide. Paths too long to build are left to the save stage.
+static int check_output_names(char **input_files, size_t input_count, QTBatchOptions *options)
+{
+    QTBatchOutputName *names = (QTBatchOutputName *)malloc((input_count ? input_count : 1) * sizeof(QTBatchOutputName));
+    if (!names)
+    {
+        ERROR("Memory allocation failed for batch output names");
+        return 0;
+    }
+    int ok = 1;
+    size_t count = 0;
+    char path[4096];
+    for (size_t i = 0; ok && i < input_count; i++)
+    {
+        if (!get_qt_batch_output_path(input_files[i], options, path, sizeof(path))) continue;
+        size_t length = strlen(path);
+        names[count].path = (char *)malloc(length + 1);
+        if (!names[count].path)
+        {
+            ERROR("Memory allocation failed for batch output names");
+            ok = 0;
+            break;
+        }
+        memcpy(names[count].path, path, length + 1);
+        names[count++].index = i;
+    }
+    if (ok && count > 1) qsort(names, count, sizeof(names[0]), compare_output_names);
+    for (size_t i = 1; ok && i < count; i++)
+    {
+        if (strcmp(names[i - 1].path, names[i].path) != 0) continue;
+        ERROR("%s and %s would both be written to %s", input_files[names[i - 1].index], input_files[names[i].index], names[i].path);
+        ok = 0;
+    }
+    for (size_t i = 0; i < count; i++) free(names[i].path);
+    free(names);
+    return ok;
+}
+
+// Starts up to `count` workers and returns how many are running.
+static int start_stage(pthread_t *threads, int count, void *(*worker)(void *), QTBatch *batch)
+{
+    int started = 0;
+    while (started < count && pthread_create(&threads[started], NULL, worker, batch) == 0) started++;
+    return started;
+}
+
+// Stages start from the last one back, so every running stage always has a consumer; a
+// stage that gets fewer workers than asked for still runs, and one that gets none ends
+// the stream for the stages after it. Returns 1 when every input was written; nothing
+// runs if two inputs would be written to the same output file.
+int run_qt_batch(char **input_files, size_t input_count, QTBatchOptions *options, QTBatchReport *report)
+{
+    memset(report, 0, sizeof(*report));
+    report->inputs = input_count;
+    if (!check_output_names(input_files, input_count, options)) return 0;
+    int workers[QT_BATCH_STAGE_COUNT];
+    int total_workers = 0;
+    for (int i = 0; i < QT_BATCH_STAGE_COUNT; i++)
+    {
+        workers[i] = options->workers[i] > 0 ? options->workers[i] : 1;
+        total_workers += workers[i];
+    }
+    size_t capacity = options->queue_capacity > 0 ? (size_t)options->queue_capacity : QT_BATCH_DEFAULT_QUEUE_CAPACITY;
+
+    QTBatch batch;
+    memset(&batch, 0, sizeof(batch));
+    batch.input_files = input_files;
+    batch.input_count = input_count;
+    batch.options = options;
+    pthread_t *threads = (pthread_t *)malloc((size_t)total_workers * sizeof(pthread_t));
+    if (!threads || !init_batch_queue(&batch.queues[0], capacity, workers[QT_BATCH_LOAD]))
+    {
+        free(threads);
+        ERROR("Memory allocation failed for batch pipeline");
+        return 0;
+    }
+    if (!init_batch_queue(&batch.queues[1], capacity, workers[QT_BATCH_BUILD]))
+    {
+        destroy_batch_queue(&batch.queues[0]);
+        free(threads);
+        ERROR("Memory allocation failed for batch pipeline");
+        return 0;
+    }
+    pthread_mutex_init(&batch.lock, NULL);
+
+    double start = batch_now();
+    pthread_t *save_threads = threads;
+    pthread_t *build_threads = save_threads + workers[QT_BATCH_SAVE];
+    pthread_t *load_threads = build_threads + workers[QT_BATCH_BUILD];
+    int started[QT_BATCH_STAGE_COUNT] = {0, 0, 0};
+    started[QT_BATCH_SAVE] = start_stage(save_threads, workers[QT_BATCH_SAVE], save_worker, &batch);
+    if (started[QT_BATCH_SAVE] > 0) started[QT_BATCH_BUILD] = start_stage(build_threads, workers[QT_BATCH_BUILD], build_worker, &batch);
+    if (started[QT_BATCH_BUILD] > 0) started[QT_BATCH_LOAD] = start_stage(load_threads, workers[QT_BATCH_LOAD], load_worker, &batch);
+    for (int i = started[QT_BATCH_BUILD]; i < workers[QT_BATCH_BUILD]; i++) finish_batch_producer(&batch.queues[1]);
+    for (int i = started[QT_BATCH_LOAD]; i < workers[QT_BATCH_LOAD]; i++) finish_batch_producer(&batch.queues[0]);
+    if (started[QT_BATCH_SAVE] < workers[QT_BATCH_SAVE] || started[QT_BATCH_BUILD] < workers[QT_BATCH_BUILD] || started[QT_BATCH_LOAD] < workers[QT_BATCH_LOAD])
+    {
+        ERROR("Started only %d/%d/%d of the requested batch workers", started[QT_BATCH_LOAD], started[QT_BATCH_BUILD], started[QT_BATCH_SAVE]);
+    }
+
+    for (int i = 0; i < started[QT_BATCH_LOAD]; i++) pthread_join(load_threads[i], NULL);
+    for (int i = 0; i < started[QT_BATCH_BUILD]; i++) pthread_join(build_threads[i], NULL);
+    for (int i = 0; i < started[QT_BATCH_SAVE]; i++) pthread_join(save_threads[i], NULL);
+    report->elapsed_seconds = batch_now() - start;
+
+    for (int i = 0; i < QT_BATCH_STAGE_COUNT; i++)
+    {
+        report->stages[i] = batch.stages[i];
+        report->stages[i].workers = started[i];
+    }
+    report->completed = batch.stages[QT_BATCH_SAVE].items;
+
+    destroy_batch_queue(&batch.queues[0]);
+    destroy_batch_queue(&batch.queues[1]);
+    pthread_mutex_destroy(&batch.lock);
+    free(threads);
+    return report->completed == input_count;
+}
@@ -0,0 +1,185 @@
+#include <dirent.h>
+#include <errno.h>
+#include <limits.h>
+#include <math.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "qtree_batch.h"
+
+typedef struct FileList
+{
+    char **paths;
+    size_t count;
+    size_t capacity;
+} FileList;
+
+static int append_path(FileList *list, const char *path)
+{
+    if (list->count == list->capacity)
+    {
+        size_t capacity = list->capacity ? 2 * list->capacity : 64;
+        char **grown = (char **)realloc(list->paths, capacity * sizeof(char *));
+        if (!grown) return 0;
+        list->paths = grown;
+        list->capacity = capacity;
+    }
+    size_t length = strlen(path);
+    char *copy = (char *)malloc(length + 1);
+    if (!copy) return 0;
+    memcpy(copy, path, length + 1);
+    list->paths[list->count++] = copy;
+    return 1;
+}
+
+static int compare_paths(const void *a, const void *b)
+{
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+// Every .ppm file in the directory, sorted by name.
+static int list_directory(char *directory, FileList *list)
+{
+    DIR *dir = opendir(directory);
+    if (!dir) return 0;
+    int ok = 1;
+    struct dirent *entry;
+    while (ok && (entry = readdir(dir)) != NULL)
+    {
+        size_t name_length = strlen(entry->d_name);
+        if (name_length < 4 || strcmp(entry->d_name + name_length - 4, ".ppm") != 0) continue;
+        char path[4096];
+        snprintf(path, sizeof(path), "%s/%s", directory, entry->d_name);
+        ok = append_path(list, path);
+    }
+    closedir(dir);
+    if (list->count > 1) qsort(list->paths, list->count, sizeof(char *), compare_paths);
+    return ok;
+}
+
+// One path per line; blank lines are skipped.
+static int read_list_file(char *filename, FileList *list)
+{
+    FILE *file = fopen(filename, "r");
+    if (!file) return 0;
+    int ok = 1;
+    char line[4096];
+    while (ok && fgets(line, sizeof(line), file))
+    {
+        size_t length = strcspn(line, "\r\n");
+        line[length] = '\0';
+        if (length > 0) ok = append_path(list, line);
+    }
+    fclose(file);
+    return ok;
+}
+
+// The whole argument must be a finite number of at least zero.
+static int parse_rmse(char *text, double *value)
+{
+    char *end;
+    errno = 0;
+    *value = strtod(text, &end);
+    return end != text && *end == '\0' && errno == 0 && isfinite(*value) && *value >= 0;
+}
+
+// The whole argument must be a positive int.
+static int parse_count(char *text, int *value)
+{
+    char *end;
+    errno = 0;
+    long parsed = strtol(text, &end, 10);
+    if (end == text || *end != '\0' || errno != 0 || parsed <= 0 || parsed > INT_MAX) return 0;
+    *value = (int)parsed;
+    return 1;
+}
+
+static void free_file_list(FileList *list)
+{
+    for (size_t i = 0; i < list->count; i++) free(list->paths[i]);
+    free(list->paths);
+}
+
+static int usage(char *program)
+{
+    fprintf(stderr, "usage: %s <directory|list file> <max_rmse> <preorder|p3|p5|p6> <output directory> "
+                    "[load workers] [build workers] [save workers] [queue capacity]\n", program);
+    return 2;
+}
+
+static int parse_output(char *name, QTBatchOptions *options)
+{
+    if (strcmp(name, "preorder") == 0) options->output = QT_BATCH_PREORDER;
+    else if (strcmp(name, "p3") == 0 || strcmp(name, "p5") == 0 || strcmp(name, "p6") == 0)
+    {
+        options->output = QT_BATCH_PPM;
+        options->format = name[1] == '3' ? IMAGE_FORMAT_P3 : name[1] == '5' ? IMAGE_FORMAT_P5 : IMAGE_FORMAT_P6;
+    }
+    else return 0;
+    return 1;
+}
+
+// Builds quadtrees for every .ppm in a directory (or every path in a list file) and writes
+// them as preorder text or rendered PPMs, pipelining load, build and save.
+// ./build/qtree_batch <directory|list file> <max_rmse> <preorder|p3|p5|p6> <output directory>
+//                     [load workers] [build workers] [save workers] [queue capacity]
+int main(int argc, char **argv)
+{
+    if (argc < 5 || argc > 9) return usage(argv[0]);
+
+    double max_rmse;
+    if (!parse_rmse(argv[2], &max_rmse))
+    {
+        ERROR("max_rmse must be a number of at least 0, not %s", argv[2]);
+        return usage(argv[0]);
+    }
+    QTBatchOptions options;
+    init_qt_batch_options(&options, max_rmse, QT_BATCH_PREORDER, argv[4]);
+    if (!parse_output(argv[3], &options))
+    {
+        ERROR("Unknown output format %s", argv[3]);
+        return usage(argv[0]);
+    }
+    for (int i = 5; i < argc; i++)
+    {
+        int *count = i < 5 + QT_BATCH_STAGE_COUNT ? &options.workers[i - 5] : &options.queue_capacity;
+        if (!parse_count(argv[i], count))
+        {
+            ERROR("Worker counts and queue capacity must be positive integers, not %s", argv[i]);
+            return usage(argv[0]);
+        }
+    }
+
+    FileList inputs = {NULL, 0, 0};
+    struct stat st;
+    int listed = stat(argv[1], &st) == 0 && S_ISDIR(st.st_mode) ? list_directory(argv[1], &inputs) : read_list_file(argv[1], &inputs);
+    if (!listed)
+    {
+        ERROR("Failed to list inputs from %s", argv[1]);
+        free_file_list(&inputs);
+        return 1;
+    }
+    if (mkdir(options.output_directory, 0700) != 0 && errno != EEXIST)
+    {
+        ERROR("Failed to create output directory %s: %s", options.output_directory, strerror(errno));
+        free_file_list(&inputs);
+        return 1;
+    }
+
+    QTBatchReport report;
+    int ok = run_qt_batch(inputs.paths, inputs.count, &options, &report);
+
+    printf("%zu of %zu images written to %s in %.3f s (%.1f images/s)\n\n", report.completed, report.inputs, options.output_directory,
+           report.elapsed_seconds, report.elapsed_seconds > 0 ? (double)report.completed / report.elapsed_seconds : 0.0);
+    printf("%-8s %8s %8s %8s %10s %10s %10s %12s\n", "stage", "workers", "items", "failed", "busy(s)", "starved(s)", "blocked(s)", "items/busy s");
+    for (int i = 0; i < QT_BATCH_STAGE_COUNT; i++)
+    {
+        QTBatchStageStats *stage = &report.stages[i];
+        printf("%-8s %8d %8zu %8zu %10.3f %10.3f %10.3f %12.1f\n", qt_batch_stage_name((QTBatchStageKind)i), stage->workers, stage->items,
+               stage->failures, stage->busy_seconds, stage->starved_seconds, stage->blocked_seconds,
+               stage->busy_seconds > 0 ? (double)stage->items / stage->busy_seconds : 0.0);
+    }
+
+    free_file_list(&inputs);
+    return ok ? 0 : 1;
+}
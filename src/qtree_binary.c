@@ -0,0 +1,337 @@
+#include "qtree_binary.h"
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define QT_BINARY_STACK_SIZE 256
+
+static void flush_binary_buffer(QTBinaryWriter *writer)
+{
+    if (writer->used > 0 && fwrite(writer->buffer, 1, writer->used, writer->file) != writer->used) writer->failed = 1;
+    writer->used = 0;
+}
+
+static void append_binary_bytes(QTBinaryWriter *writer, const unsigned char *bytes, size_t count)
+{
+    if (writer->used + count > sizeof(writer->buffer)) flush_binary_buffer(writer);
+    memcpy(writer->buffer + writer->used, bytes, count);
+    writer->used += count;
+}
+
+static void flush_binary_group(QTBinaryWriter *writer)
+{
+    if (writer->group_count == 0) return;
+    append_binary_bytes(writer, writer->group, 1 + (size_t)writer->group_count);
+    writer->group_count = 0;
+}
+
+static void put_u32(unsigned char *out, unsigned int value)
+{
+    for (int i = 0; i < 4; i++) out[i] = (unsigned char)(value >> (8 * i));
+}
+
+static unsigned int get_u32(const unsigned char *in)
+{
+    return (unsigned int)in[0] | (unsigned int)in[1] << 8 | (unsigned int)in[2] << 16 | (unsigned int)in[3] << 24;
+}
+
+// Writes a bare node stream (no header) into a file the caller keeps open, e.g. to
+// spill several subtrees into one file; detach_binary_qt_writer ends on a whole byte.
+QTBinaryWriter *attach_binary_qt_writer(FILE *file)
+{
+    QTBinaryWriter *writer = (QTBinaryWriter *)malloc(sizeof(QTBinaryWriter));
+    if (!writer)
+    {
+        ERROR("Memory allocation failed for QTBinaryWriter");
+        return NULL;
+    }
+    writer->file = file;
+    writer->failed = 0;
+    writer->group_count = 0;
+    writer->used = 0;
+    return writer;
+}
+
+QTBinaryWriter *open_binary_qt_writer(char *filename, int width, int height)
+{
+    FILE *file = fopen(filename, "wb");
+    if (!file)
+    {
+        ERROR("Failed to open file %s for writing", filename);
+        return NULL;
+    }
+    QTBinaryWriter *writer = attach_binary_qt_writer(file);
+    if (!writer)
+    {
+        fclose(file);
+        return NULL;
+    }
+
+    unsigned char header[QT_BINARY_HEADER_SIZE];
+    memcpy(header, QT_BINARY_MAGIC, 3);
+    header[3] = QT_BINARY_VERSION;
+    put_u32(header + 4, (unsigned int)width);
+    put_u32(header + 8, (unsigned int)height);
+    append_binary_bytes(writer, header, sizeof(header));
+    return writer;
+}
+
+int write_binary_qt_node(QTBinaryWriter *writer, int is_leaf, unsigned char intensity)
+{
+    if (writer->group_count == 0) writer->group[0] = 0;
+    if (!is_leaf) writer->group[0] |= (unsigned char)(1 << writer->group_count);
+    writer->group[1 + writer->group_count++] = intensity;
+    if (writer->group_count == 8) flush_binary_group(writer);
+    return !writer->failed;
+}
+
+int detach_binary_qt_writer(QTBinaryWriter *writer)
+{
+    if (!writer) return 0;
+    flush_binary_group(writer);
+    flush_binary_buffer(writer);
+    int ok = !writer->failed;
+    free(writer);
+    return ok;
+}
+
+int close_binary_qt_writer(QTBinaryWriter *writer)
+{
+    if (!writer) return 0;
+    FILE *file = writer->file;
+    int ok = detach_binary_qt_writer(writer);
+    if (fclose(file) != 0) ok = 0;
+    return ok;
+}
+
+static int next_binary_byte(QTBinaryReader *reader, unsigned char *byte)
+{
+    if (reader->position == reader->length)
+    {
+        reader->length = fread(reader->buffer, 1, sizeof(reader->buffer), reader->file);
+        reader->position = 0;
+        if (reader->length == 0) return 0;
+    }
+    *byte = reader->buffer[reader->position++];
+    return 1;
+}
+
+// Reads a bare node stream starting at the file's current position. The reader buffers
+// ahead, so the caller must seek before reusing the file after detaching.
+QTBinaryReader *attach_binary_qt_reader(FILE *file, int width, int height)
+{
+    QTBinaryReader *reader = (QTBinaryReader *)malloc(sizeof(QTBinaryReader));
+    if (!reader)
+    {
+        ERROR("Memory allocation failed for QTBinaryReader");
+        return NULL;
+    }
+    reader->file = file;
+    reader->width = width;
+    reader->height = height;
+    reader->group_left = 0;
+    reader->position = 0;
+    reader->length = 0;
+    return reader;
+}
+
+QTBinaryReader *open_binary_qt_reader(char *filename)
+{
+    FILE *file = fopen(filename, "rb");
+    if (!file) return NULL;
+    QTBinaryReader *reader = attach_binary_qt_reader(file, 0, 0);
+    if (!reader)
+    {
+        fclose(file);
+        return NULL;
+    }
+
+    unsigned char header[QT_BINARY_HEADER_SIZE];
+    size_t count = 0;
+    while (count < sizeof(header) && next_binary_byte(reader, &header[count])) count++;
+    unsigned int width = get_u32(header + 4);
+    unsigned int height = get_u32(header + 8);
+    if (count < sizeof(header) || memcmp(header, QT_BINARY_MAGIC, 3) != 0 || header[3] != QT_BINARY_VERSION ||
+        width == 0 || height == 0 || width > INT_MAX || height > INT_MAX)
+    {
+        ERROR("%s is not a version %d binary quadtree", filename, QT_BINARY_VERSION);
+        close_binary_qt_reader(reader);
+        return NULL;
+    }
+    reader->width = (int)width;
+    reader->height = (int)height;
+    return reader;
+}
+
+int read_binary_qt_node(QTBinaryReader *reader, int *is_leaf, unsigned char *intensity)
+{
+    if (reader->group_left == 0)
+    {
+        if (!next_binary_byte(reader, &reader->flags)) return 0;
+        reader->group_left = 8;
+    }
+    int bit = 8 - reader->group_left--;
+    *is_leaf = !((reader->flags >> bit) & 1);
+    return next_binary_byte(reader, intensity);
+}
+
+void detach_binary_qt_reader(QTBinaryReader *reader)
+{
+    free(reader);
+}
+
+void close_binary_qt_reader(QTBinaryReader *reader)
+{
+    if (reader)
+    {
+        fclose(reader->file);
+        free(reader);
+    }
+}
+
+int write_binary_qt_subtree(QTBinaryWriter *writer, QTNode *node, QTRegion region)
+{
+    if (!node) return 0;
+    if (!write_binary_qt_node(writer, node->is_leaf, node->intensity)) return 0;
+    if (node->is_leaf) return 1;
+
+    QTRegion children[4];
+    if (split_qt_region(region, children) == 0) return 0;
+    for (int i = 0; i < 4; i++)
+    {
+        if (children[i].width > 0 && !write_binary_qt_subtree(writer, node->children[i], children[i])) return 0;
+    }
+    return 1;
+}
+
+// Returns 1 once the whole tree is written and the file closed, 0 otherwise.
+int save_binary_qt(QTNode *root, char *filename)
+{
+    if (!root) return 0;
+    QTBinaryWriter *writer = open_binary_qt_writer(filename, root->width, root->height);
+    if (!writer) return 0;
+    QTRegion region = {0, 0, root->width, root->height};
+    int ok = write_binary_qt_subtree(writer, root, region);
+    if (!close_binary_qt_writer(writer)) ok = 0;
+    if (!ok) ERROR("Failed to write binary quadtree %s", filename);
+    return ok;
+}
+
+QTNode *read_binary_qt_subtree(QTBinaryReader *reader, QTRegion region)
+{
+    int is_leaf;
+    unsigned char intensity;
+    if (!read_binary_qt_node(reader, &is_leaf, &intensity)) return NULL;
+
+    QTNode *node = (QTNode *)malloc(sizeof(QTNode));
+    if (!node)
+    {
+        ERROR("Memory allocation failed for QTNode");
+        return NULL;
+    }
+    node->intensity = intensity;
+    node->is_leaf = is_leaf;
+    node->width = region.width;
+    node->height = region.height;
+    for (int i = 0; i < 4; i++) node->children[i] = NULL;
+    if (is_leaf) return node;
+
+    QTRegion children[4];
+    if (split_qt_region(region, children) == 0)
+    {
+        free(node);
+        return NULL;
+    }
+    for (int i = 0; i < 4; i++)
+    {
+        if (children[i].width == 0) continue;
+        node->children[i] = read_binary_qt_subtree(reader, children[i]);
+        if (!node->children[i])
+        {
+            delete_quadtree(node);
+            return NULL;
+        }
+    }
+    return node;
+}
+
+QTNode *load_binary_qt(char *filename)
+{
+    QTBinaryReader *reader = open_binary_qt_reader(filename);
+    if (!reader) return NULL;
+    QTRegion region = {0, 0, reader->width, reader->height};
+    QTNode *root = read_binary_qt_subtree(reader, region);
+    close_binary_qt_reader(reader);
+    if (!root)
+    {
+        ERROR("Failed to load quadtree from file.");
+    }
+    return root;
+}
+
+// Streams the text preorder file node by node; `pending` counts nodes announced by
+// their parents but not yet read, so conversion stops exactly at the end of the tree.
+int convert_preorder_qt_to_binary(char *text_filename, char *binary_filename)
+{
+    FILE *file = fopen(text_filename, "r");
+    if (!file) return 0;
+
+    QTBinaryWriter *writer = NULL;
+    long long pending = 1;
+    char node_type;
+    int intensity, row, height, col, width;
+    while (pending > 0 && fscanf(file, " %c %d %d %d %d %d", &node_type, &intensity, &row, &height, &col, &width) == 6)
+    {
+        if (!writer && !(writer = open_binary_qt_writer(binary_filename, width, height))) break;
+        pending--;
+        if (node_type != 'L') pending += (width > 1 && height > 1) ? 4 : 2;
+        if (!write_binary_qt_node(writer, node_type == 'L', (unsigned char)intensity)) break;
+    }
+    fclose(file);
+
+    int ok = close_binary_qt_writer(writer) && pending == 0;
+    if (!ok) ERROR("Failed to convert %s to binary", text_filename);
+    return ok;
+}
+
+int convert_binary_qt_to_preorder(char *binary_filename, char *text_filename)
+{
+    QTBinaryReader *reader = open_binary_qt_reader(binary_filename);
+    if (!reader) return 0;
+    FILE *file = fopen(text_filename, "w");
+    if (!file)
+    {
+        ERROR("Failed to open file for writing.");
+        close_binary_qt_reader(reader);
+        return 0;
+    }
+
+    QTRegion stack[QT_BINARY_STACK_SIZE];
+    int top = 0;
+    int ok = 1;
+    stack[top++] = (QTRegion){0, 0, reader->width, reader->height};
+    while (ok && top > 0)
+    {
+        QTRegion region = stack[--top];
+        int is_leaf;
+        unsigned char intensity;
+        if (!read_binary_qt_node(reader, &is_leaf, &intensity))
+        {
+            ok = 0;
+            break;
+        }
+        fprintf(file, "%c %d %d %d %d %d\n", is_leaf ? 'L' : 'N', intensity, region.row, region.height, region.col, region.width);
+        if (is_leaf) continue;
+
+        QTRegion children[4];
+        ok = split_qt_region(region, children) > 0;
+        for (int child = 3; child >= 0; child--)
+        {
+            if (children[child].width > 0) stack[top++] = children[child];
+        }
+    }
+    if (fclose(file) != 0) ok = 0;
+    close_binary_qt_reader(reader);
+    if (!ok) ERROR("Failed to convert %s to text", binary_filename);
+    return ok;
+}
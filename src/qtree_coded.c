@@ -0,0 +1,730 @@
+#include "qtree_coded.h"
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+// The prediction the encoder and decoder both make for a node before its intensity is
+// coded. Truncated means hide up to one unit per pixel of their region's sum, so each sum
+// is estimated at the middle of its range.
+static inline __attribute__((always_inline)) unsigned char predict_coded_intensity(QTCodedModel *model, QTCodedFrame *frame, int *last_child)
+{
+    *last_child = 0;
+    if (frame->depth == 0) return 128;
+    QTCodedFamily *family = &model->families[frame->depth - 1];
+    if (family->children_left > 1) return family->intensity;
+
+    *last_child = 1;
+    long long pixel_count = (long long)frame->region.width * frame->region.height;
+    long long parent_sum = (long long)(family->intensity * family->pixel_count + (family->pixel_count - 1) / 2);
+    long long remaining = parent_sum - (long long)family->children_sum;
+    if (remaining <= 0) return 0;
+    long long mean = remaining / pixel_count;
+    return (unsigned char)(mean > 255 ? 255 : mean);
+}
+
+// The stack helpers take its height separately so the decoder can keep it in a register.
+// Frames are stored and loaded whole: a child is usually popped right after it is pushed,
+// and a load cannot be forwarded from stores narrower than itself.
+static inline __attribute__((always_inline)) void push_coded_frame(QTCodedModel *model, int *top, int row, int col, int width, int height, int depth)
+{
+    QTCodedFrame frame = {{row, col, width, height}, depth};
+    model->stack[(*top)++] = frame;
+}
+
+static inline __attribute__((always_inline)) QTCodedFrame pop_coded_frame(QTCodedModel *model, int *top)
+{
+    return model->stack[--*top];
+}
+
+static inline __attribute__((always_inline)) void record_coded_node(QTCodedModel *model, QTCodedFrame *frame, unsigned char intensity)
+{
+    if (frame->depth == 0) return;
+    unsigned long long pixel_count = (unsigned long long)frame->region.width * frame->region.height;
+    QTCodedFamily *family = &model->families[frame->depth - 1];
+    family->children_left--;
+    family->children_sum += intensity * pixel_count + (pixel_count - 1) / 2;
+}
+
+// Records a coded node in its parent's family and queues its children, if any, in the
+// order split_qt_region gives them, last child first.
+static inline __attribute__((always_inline)) int finish_coded_node(QTCodedModel *model, int *top, QTCodedFrame *frame, int is_leaf, unsigned char intensity)
+{
+    QTRegion region = frame->region;
+    unsigned long long pixel_count = (unsigned long long)region.width * region.height;
+    record_coded_node(model, frame, intensity);
+    if (is_leaf) return 1;
+
+    int count = (region.width > 1) + (region.height > 1);
+    count = count == 2 ? 4 : count == 1 ? 2 : 0;
+    if (count == 0 || frame->depth + 1 >= QT_CODED_DEPTHS || *top + count > QT_CODED_STACK_SIZE) return 0;
+    QTCodedFamily *family = &model->families[frame->depth];
+    family->intensity = intensity;
+    family->children_left = count;
+    family->pixel_count = pixel_count;
+    family->children_sum = 0;
+
+    int depth = frame->depth + 1;
+    int half_width = region.width / 2, half_height = region.height / 2;
+    if (count == 4)
+    {
+        push_coded_frame(model, top, region.row + half_height, region.col + half_width, region.width - half_width, region.height - half_height, depth);
+        push_coded_frame(model, top, region.row + half_height, region.col, half_width, region.height - half_height, depth);
+        push_coded_frame(model, top, region.row, region.col + half_width, region.width - half_width, half_height, depth);
+        push_coded_frame(model, top, region.row, region.col, half_width, half_height, depth);
+    }
+    else if (region.width > 1)
+    {
+        push_coded_frame(model, top, region.row, region.col + half_width, region.width - half_width, region.height, depth);
+        push_coded_frame(model, top, region.row, region.col, half_width, region.height, depth);
+    }
+    else
+    {
+        push_coded_frame(model, top, region.row + half_height, region.col, region.width, region.height - half_height, depth);
+        push_coded_frame(model, top, region.row, region.col, region.width, half_height, depth);
+    }
+    return 1;
+}
+
+static int zigzag_delta(unsigned char intensity, unsigned char prediction)
+{
+    signed char delta = (signed char)(unsigned char)(intensity - prediction);
+    return delta >= 0 ? 2 * delta : -2 * delta - 1;
+}
+
+// The difference to add to the prediction, modulo 256.
+static unsigned char unzigzag_delta(int code)
+{
+    return (unsigned char)((code >> 1) ^ -(code & 1));
+}
+
+// A region's level is 0 for a single pixel and otherwise the bit length of its longer
+// side minus one, so each level holds regions of about the same size wherever they sit
+// in the tree.
+static inline __attribute__((always_inline)) int coded_context(QTCodedFrame *frame, int last_child)
+{
+    int size = frame->region.width > frame->region.height ? frame->region.width : frame->region.height;
+    int level = size > 1 ? 32 - __builtin_clz((unsigned int)(size - 1)) : 0;
+    if (level > QT_CODED_LEVELS - 1) level = QT_CODED_LEVELS - 1;
+    return level * 2 + last_child;
+}
+
+// Zigzagged differences 0 and 1 are their own classes; a larger one is classed by its bit
+// length and the bit below its leading one, leaving its lower bits to send as they are.
+static inline __attribute__((always_inline)) int coded_delta_class(int code)
+{
+    if (code < 2) return code;
+    int length = 32 - __builtin_clz((unsigned int)code);
+    return 2 * (length - 1) + ((code >> (length - 2)) & 1);
+}
+
+static int coded_class_extra_bits(int delta_class)
+{
+    return delta_class < 2 ? 0 : delta_class / 2 - 1;
+}
+
+static int coded_class_base(int delta_class)
+{
+    return delta_class < 2 ? delta_class : (2 | (delta_class & 1)) << (delta_class / 2 - 1);
+}
+
+typedef struct QTCodedWeight
+{
+    unsigned int weight;
+    int symbol;
+} QTCodedWeight;
+
+// Sorts by weight, then symbol. Insertion sort: there are at most QT_CODED_SYMBOLS leaves
+// and this runs on every rebuild.
+static void sort_coded_weights(QTCodedWeight *leaves, int count)
+{
+    for (int i = 1; i < count; i++)
+    {
+        QTCodedWeight leaf = leaves[i];
+        int j = i;
+        for (; j > 0 && (leaves[j - 1].weight > leaf.weight || (leaves[j - 1].weight == leaf.weight && leaves[j - 1].symbol > leaf.symbol)); j--)
+        {
+            leaves[j] = leaves[j - 1];
+        }
+        leaves[j] = leaf;
+    }
+}
+
+// Huffman code lengths for `frequencies`, all of them non-zero, built with the two-queue
+// method over the symbols sorted by weight. While the longest code is over
+// QT_CODED_MAX_CODE_LENGTH the weights are halved, rounding up, and the code is rebuilt.
+static void build_coded_lengths(const unsigned int *frequencies, int symbol_count, unsigned char *lengths)
+{
+    QTCodedWeight leaves[QT_CODED_SYMBOLS];
+    unsigned int weights[2 * QT_CODED_SYMBOLS];
+    int parents[2 * QT_CODED_SYMBOLS];
+    for (int symbol = 0; symbol < symbol_count; symbol++) leaves[symbol] = (QTCodedWeight){frequencies[symbol], symbol};
+
+    for (;;)
+    {
+        sort_coded_weights(leaves, symbol_count);
+        for (int i = 0; i < symbol_count; i++) weights[i] = leaves[i].weight;
+        int next_leaf = 0, next_internal = symbol_count, nodes = symbol_count;
+        while (nodes < 2 * symbol_count - 1)
+        {
+            int picked[2];
+            for (int k = 0; k < 2; k++)
+            {
+                int take_leaf = next_leaf < symbol_count && (next_internal == nodes || weights[next_leaf] <= weights[next_internal]);
+                picked[k] = take_leaf ? next_leaf++ : next_internal++;
+            }
+            weights[nodes] = weights[picked[0]] + weights[picked[1]];
+            parents[picked[0]] = parents[picked[1]] = nodes;
+            nodes++;
+        }
+
+        int depths[2 * QT_CODED_SYMBOLS];
+        int longest = 0;
+        depths[nodes - 1] = 0;
+        for (int i = nodes - 2; i >= 0; i--)
+        {
+            depths[i] = depths[parents[i]] + 1;
+            if (i < symbol_count && depths[i] > longest) longest = depths[i];
+        }
+        if (longest <= QT_CODED_MAX_CODE_LENGTH)
+        {
+            for (int i = 0; i < symbol_count; i++) lengths[leaves[i].symbol] = (unsigned char)depths[i];
+            return;
+        }
+        for (int i = 0; i < symbol_count; i++) leaves[i].weight = (leaves[i].weight + 1) / 2;
+    }
+}
+
+// Canonical codes for `lengths`, bit-reversed for the LSB-first stream.
+static void assign_coded_codes(const unsigned char *lengths, int symbol_count, unsigned short *codes)
+{
+    int counts[QT_CODED_MAX_CODE_LENGTH + 1] = {0};
+    for (int symbol = 0; symbol < symbol_count; symbol++) counts[lengths[symbol]]++;
+    unsigned int next[QT_CODED_MAX_CODE_LENGTH + 1];
+    unsigned int code = 0;
+    for (int length = 1; length <= QT_CODED_MAX_CODE_LENGTH; length++)
+    {
+        code = (code + (unsigned int)counts[length - 1]) << 1;
+        next[length] = code;
+    }
+    for (int symbol = 0; symbol < symbol_count; symbol++)
+    {
+        int length = lengths[symbol];
+        unsigned int canonical = next[length]++, reversed = 0;
+        for (int bit = 0; bit < length; bit++) reversed |= ((canonical >> bit) & 1) << (length - 1 - bit);
+        codes[symbol] = (unsigned short)reversed;
+    }
+}
+
+static void rebuild_coded_context(QTCodedContext *context)
+{
+    build_coded_lengths(context->counts, context->symbol_count, context->lengths);
+    if (context->interval < QT_CODED_MAX_REBUILD)
+    {
+        context->interval *= 2;
+    }
+    else
+    {
+        for (int symbol = 0; symbol < context->symbol_count; symbol++) context->counts[symbol] = (context->counts[symbol] + 1) / 2;
+    }
+    context->until_rebuild = context->interval;
+}
+
+// Counts `symbol` in `context`. Returns 1 when this rebuilt the context's code lengths.
+static inline __attribute__((always_inline)) int count_coded_symbol(QTCodedContext *context, int symbol)
+{
+    context->counts[symbol]++;
+    if (--context->until_rebuild > 0) return 0;
+    rebuild_coded_context(context);
+    return 1;
+}
+
+// Every context starts with a count of one for each symbol, which also keeps every code
+// complete: any bit pattern decodes to some symbol.
+static void init_coded_model(QTCodedModel *model, int width, int height)
+{
+    for (int index = 0; index < QT_CODED_CONTEXTS; index++)
+    {
+        QTCodedContext *context = &model->contexts[index];
+        context->symbol_count = index < 2 ? QT_CODED_SYMBOLS / 2 : QT_CODED_SYMBOLS;
+        for (int symbol = 0; symbol < context->symbol_count; symbol++) context->counts[symbol] = 1;
+        build_coded_lengths(context->counts, context->symbol_count, context->lengths);
+        context->interval = QT_CODED_FIRST_REBUILD;
+        context->until_rebuild = QT_CODED_FIRST_REBUILD;
+    }
+    model->top = 0;
+    push_coded_frame(model, &model->top, 0, 0, width, height, 0);
+}
+
+static void flush_coded_buffer(QTCodedWriter *writer)
+{
+    if (writer->used > 0 && fwrite(writer->buffer, 1, writer->used, writer->file) != writer->used) writer->failed = 1;
+    writer->used = 0;
+}
+
+static void put_coded_byte(QTCodedWriter *writer, unsigned char byte)
+{
+    if (writer->used == sizeof(writer->buffer)) flush_coded_buffer(writer);
+    writer->buffer[writer->used++] = byte;
+}
+
+// Appends the low `count` bits of `value` to the stream, at most 16 at a time.
+static inline __attribute__((always_inline)) void put_coded_bits(QTCodedWriter *writer, unsigned int value, int count)
+{
+    writer->bits |= (unsigned long long)value << writer->bit_count;
+    writer->bit_count += count;
+    while (writer->bit_count >= 8)
+    {
+        put_coded_byte(writer, (unsigned char)writer->bits);
+        writer->bits >>= 8;
+        writer->bit_count -= 8;
+    }
+}
+
+static void put_u32(unsigned char *out, unsigned int value)
+{
+    for (int i = 0; i < 4; i++) out[i] = (unsigned char)(value >> (8 * i));
+}
+
+static unsigned int get_u32(const unsigned char *in)
+{
+    return (unsigned int)in[0] | (unsigned int)in[1] << 8 | (unsigned int)in[2] << 16 | (unsigned int)in[3] << 24;
+}
+
+static void assign_writer_codes(QTCodedWriter *writer, int index)
+{
+    QTCodedContext *context = &writer->model.contexts[index];
+    assign_coded_codes(context->lengths, context->symbol_count, writer->codes[index]);
+}
+
+QTCodedWriter *open_coded_qt_writer(char *filename, int width, int height)
+{
+    if (width <= 0 || height <= 0) return NULL;
+    QTCodedWriter *writer = (QTCodedWriter *)malloc(sizeof(QTCodedWriter));
+    if (!writer)
+    {
+        ERROR("Memory allocation failed for QTCodedWriter");
+        return NULL;
+    }
+    writer->file = fopen(filename, "wb");
+    if (!writer->file)
+    {
+        ERROR("Failed to open file %s for writing", filename);
+        free(writer);
+        return NULL;
+    }
+    writer->failed = 0;
+    writer->bits = 0;
+    writer->bit_count = 0;
+    writer->used = 0;
+    init_coded_model(&writer->model, width, height);
+    for (int index = 0; index < QT_CODED_CONTEXTS; index++) assign_writer_codes(writer, index);
+
+    unsigned char header[QT_CODED_HEADER_SIZE];
+    memcpy(header, QT_CODED_MAGIC, 3);
+    header[3] = QT_CODED_VERSION;
+    put_u32(header + 4, (unsigned int)width);
+    put_u32(header + 8, (unsigned int)height);
+    for (size_t i = 0; i < sizeof(header); i++) put_coded_byte(writer, header[i]);
+    return writer;
+}
+
+// Nodes must arrive in preorder; the writer fails once the tree is complete or when a
+// node cannot be split.
+int write_coded_qt_node(QTCodedWriter *writer, int is_leaf, unsigned char intensity)
+{
+    QTCodedModel *model = &writer->model;
+    if (writer->failed || model->top == 0)
+    {
+        writer->failed = 1;
+        return 0;
+    }
+    QTCodedFrame frame = pop_coded_frame(model, &model->top);
+
+    int last_child;
+    unsigned char prediction = predict_coded_intensity(model, &frame, &last_child);
+    int index = coded_context(&frame, last_child);
+    int code = zigzag_delta(intensity, prediction);
+    int delta_class = coded_delta_class(code);
+    int symbol = index < 2 ? delta_class : delta_class << 1 | !is_leaf;
+    QTCodedContext *context = &model->contexts[index];
+    int length = context->lengths[symbol];
+    put_coded_bits(writer, writer->codes[index][symbol] | (unsigned int)(code - coded_class_base(delta_class)) << length,
+                   length + coded_class_extra_bits(delta_class));
+    if (count_coded_symbol(context, symbol)) assign_writer_codes(writer, index);
+    if (!finish_coded_node(model, &model->top, &frame, is_leaf, intensity)) writer->failed = 1;
+    return !writer->failed;
+}
+
+// Writes out the last partial byte. Fails, after closing the file, if the nodes written
+// do not form a whole tree or a write failed.
+int close_coded_qt_writer(QTCodedWriter *writer)
+{
+    if (!writer) return 0;
+    int ok = !writer->failed && writer->model.top == 0;
+    if (ok)
+    {
+        if (writer->bit_count > 0) put_coded_byte(writer, (unsigned char)writer->bits);
+        flush_coded_buffer(writer);
+        ok = !writer->failed;
+    }
+    if (fclose(writer->file) != 0) ok = 0;
+    free(writer);
+    return ok;
+}
+
+// Refills the input buffer; past the end of the file it supplies zero bytes, which are
+// counted so that decoding them fails the stream.
+static void refill_coded_buffer(QTCodedReader *reader)
+{
+    reader->length = fread(reader->buffer, 1, sizeof(reader->buffer), reader->file);
+    reader->position = 0;
+    if (reader->length == 0)
+    {
+        reader->buffer[0] = 0;
+        reader->length = 1;
+        reader->overrun += 8;
+    }
+}
+
+static unsigned char next_coded_byte(QTCodedReader *reader)
+{
+    if (reader->position == reader->length) refill_coded_buffer(reader);
+    return reader->buffer[reader->position++];
+}
+
+static void fill_coded_bits(QTCodedReader *reader)
+{
+    while (reader->bit_count <= 56)
+    {
+        reader->bits |= (unsigned long long)next_coded_byte(reader) << reader->bit_count;
+        reader->bit_count += 8;
+    }
+}
+
+// Fills a context's decoding table from its current code lengths.
+static void build_coded_table(QTCodedReader *reader, int index)
+{
+    QTCodedContext *context = &reader->model.contexts[index];
+    unsigned short codes[QT_CODED_SYMBOLS];
+    assign_coded_codes(context->lengths, context->symbol_count, codes);
+    unsigned int *table = reader->tables[index];
+    for (int symbol = 0; symbol < context->symbol_count; symbol++)
+    {
+        int length = context->lengths[symbol];
+        int delta_class = index < 2 ? symbol : symbol >> 1;
+        int split = index < 2 ? 0 : symbol & 1;
+        int extra_bits = coded_class_extra_bits(delta_class);
+        unsigned int entry = (unsigned int)(length + extra_bits) | (unsigned int)length << 5 | (unsigned int)split << 9 |
+                             (unsigned int)extra_bits << 10 | (unsigned int)coded_class_base(delta_class) << 16 | (unsigned int)symbol << 24;
+        for (unsigned int code = codes[symbol]; code < QT_CODED_TABLE_SIZE; code += 1u << length) table[code] = entry;
+    }
+}
+
+QTCodedReader *open_coded_qt_reader(char *filename)
+{
+    FILE *file = fopen(filename, "rb");
+    if (!file) return NULL;
+    QTCodedReader *reader = (QTCodedReader *)malloc(sizeof(QTCodedReader));
+    if (!reader)
+    {
+        ERROR("Memory allocation failed for QTCodedReader");
+        fclose(file);
+        return NULL;
+    }
+    reader->file = file;
+    reader->failed = 0;
+    reader->overrun = 0;
+    reader->position = 0;
+    reader->length = 0;
+
+    unsigned char header[QT_CODED_HEADER_SIZE];
+    for (size_t i = 0; i < sizeof(header); i++) header[i] = next_coded_byte(reader);
+    unsigned int width = get_u32(header + 4);
+    unsigned int height = get_u32(header + 8);
+    if (reader->overrun || memcmp(header, QT_CODED_MAGIC, 3) != 0 || header[3] != QT_CODED_VERSION || width == 0 || height == 0 ||
+        width > INT_MAX || height > INT_MAX)
+    {
+        ERROR("%s is not a version %d coded quadtree", filename, QT_CODED_VERSION);
+        close_coded_qt_reader(reader);
+        return NULL;
+    }
+    reader->width = (int)width;
+    reader->height = (int)height;
+    init_coded_model(&reader->model, reader->width, reader->height);
+    for (int index = 0; index < QT_CODED_CONTEXTS; index++) build_coded_table(reader, index);
+    reader->bits = 0;
+    reader->bit_count = 0;
+    reader->pending_count = 0;
+    reader->pending_next = 0;
+    fill_coded_bits(reader);
+    return reader;
+}
+
+// Decodes the next symbol in context `index`, consuming its code and extra bits, and
+// counts it. Returns its table entry with the whole zigzagged difference in bits 16-23,
+// or 0 if the symbol ran into the zeros past the end of file.
+static inline __attribute__((always_inline)) unsigned int next_coded_entry(QTCodedReader *reader, unsigned long long *bits, int *bit_count, int index)
+{
+    if (*bit_count < QT_CODED_MAX_CODE_LENGTH + 6)
+    {
+        reader->bits = *bits;
+        reader->bit_count = *bit_count;
+        fill_coded_bits(reader);
+        *bits = reader->bits;
+        *bit_count = reader->bit_count;
+    }
+    unsigned int entry = reader->tables[index][*bits & (QT_CODED_TABLE_SIZE - 1)];
+    unsigned int extra = (unsigned int)(*bits >> ((entry >> 5) & 15)) & ((1u << ((entry >> 10) & 7)) - 1);
+    int consumed = (int)(entry & 31);
+    *bits >>= consumed;
+    *bit_count -= consumed;
+    if (count_coded_symbol(&reader->model.contexts[index], (int)(entry >> 24))) build_coded_table(reader, index);
+    return *bit_count < reader->overrun ? 0 : entry + (extra << 16);
+}
+
+// Decodes the 1x1 children of a split region of at most 2x2 pixels straight into `nodes`,
+// in preorder, without queuing them: they are leaves, each family member's pixel count is
+// one, and so the last child's prediction needs no division. Returns how many were
+// decoded, or 0 on a corrupt stream.
+static int decode_coded_pixels(QTCodedReader *reader, unsigned long long *bits, int *bit_count, QTRegion region, unsigned char intensity,
+                               QTCodedNode *nodes)
+{
+    int count = region.width * region.height;
+    long long remaining = (long long)intensity * count + (count - 1) / 2;
+    for (int child = 0; child < count; child++)
+    {
+        int last_child = child == count - 1;
+        unsigned char prediction = intensity;
+        if (last_child) prediction = (unsigned char)(remaining <= 0 ? 0 : remaining > 255 ? 255 : remaining);
+        unsigned int entry = next_coded_entry(reader, bits, bit_count, last_child);
+        if (!entry) return 0;
+        int offset = region.width == 2 ? child & 1 : 0;
+        nodes[child].region = (QTRegion){region.row + (region.width == 2 ? child >> 1 : child), region.col + offset, 1, 1};
+        nodes[child].is_leaf = 1;
+        nodes[child].intensity = (unsigned char)(prediction + unzigzag_delta((int)(entry >> 16) & 255));
+        remaining -= nodes[child].intensity;
+    }
+    return count;
+}
+
+// Decodes nodes into `nodes` while there is room for a node and its 1x1 children, keeping
+// the bit buffer and stack height in locals. Stops early at the end of the tree or on a
+// corrupt stream; `capacity` must be at least QT_CODED_STEP_NODES.
+static int decode_coded_nodes(QTCodedReader *reader, QTCodedNode *nodes, int capacity)
+{
+    QTCodedModel *model = &reader->model;
+    unsigned long long bits = reader->bits;
+    int bit_count = reader->bit_count;
+    int top = model->top;
+    int count = 0;
+    while (count + QT_CODED_STEP_NODES <= capacity && top > 0)
+    {
+        QTCodedFrame frame = pop_coded_frame(model, &top);
+        int last_child;
+        unsigned char prediction = predict_coded_intensity(model, &frame, &last_child);
+        unsigned int entry = next_coded_entry(reader, &bits, &bit_count, coded_context(&frame, last_child));
+        if (!entry)
+        {
+            reader->failed = 1;
+            break;
+        }
+
+        QTCodedNode *node = &nodes[count++];
+        node->region = frame.region;
+        node->is_leaf = !(entry & (1u << 9));
+        node->intensity = (unsigned char)(prediction + unzigzag_delta((int)(entry >> 16) & 255));
+        if (!node->is_leaf && frame.region.width <= 2 && frame.region.height <= 2 && frame.depth + 1 < QT_CODED_DEPTHS)
+        {
+            record_coded_node(model, &frame, node->intensity);
+            int pixels = decode_coded_pixels(reader, &bits, &bit_count, frame.region, node->intensity, node + 1);
+            if (!pixels)
+            {
+                reader->failed = 1;
+                break;
+            }
+            count += pixels;
+        }
+        else if (!finish_coded_node(model, &top, &frame, node->is_leaf, node->intensity))
+        {
+            reader->failed = 1;
+            break;
+        }
+    }
+    reader->bits = bits;
+    reader->bit_count = bit_count;
+    model->top = top;
+    return count;
+}
+
+// Returns the next node in preorder along with its region. Returns 0 after the last node
+// of the tree, or on a truncated or corrupt stream (reader->failed is then set).
+int read_coded_qt_node(QTCodedReader *reader, QTRegion *region, int *is_leaf, unsigned char *intensity)
+{
+    if (reader->pending_next == reader->pending_count)
+    {
+        if (reader->failed || reader->model.top == 0) return 0;
+        reader->pending_count = decode_coded_nodes(reader, reader->pending, QT_CODED_BATCH);
+        reader->pending_next = 0;
+        if (reader->pending_count == 0) return 0;
+    }
+    QTCodedNode *node = &reader->pending[reader->pending_next++];
+    *region = node->region;
+    *is_leaf = node->is_leaf;
+    *intensity = node->intensity;
+    return 1;
+}
+
+// Fills `nodes` with up to `capacity` of the next nodes in preorder, decoding straight
+// into it when there is room, which saves a call and a copy per node over
+// read_coded_qt_node. Returns how many were filled: 0 after the last node of the tree or
+// on a truncated or corrupt stream (reader->failed is then set).
+int read_coded_qt_nodes(QTCodedReader *reader, QTCodedNode *nodes, int capacity)
+{
+    int count = 0;
+    while (count < capacity && reader->pending_next < reader->pending_count) nodes[count++] = reader->pending[reader->pending_next++];
+    if (count > 0 || reader->failed || reader->model.top == 0) return count;
+    if (capacity >= QT_CODED_STEP_NODES) return decode_coded_nodes(reader, nodes, capacity);
+
+    QTRegion region;
+    int is_leaf;
+    unsigned char intensity;
+    while (count < capacity && read_coded_qt_node(reader, &region, &is_leaf, &intensity))
+    {
+        nodes[count++] = (QTCodedNode){region, is_leaf, intensity};
+    }
+    return count;
+}
+
+void close_coded_qt_reader(QTCodedReader *reader)
+{
+    if (reader)
+    {
+        fclose(reader->file);
+        free(reader);
+    }
+}
+
+static int write_coded_qt_subtree(QTCodedWriter *writer, QTNode *node, QTRegion region)
+{
+    if (!node) return 0;
+    if (!write_coded_qt_node(writer, node->is_leaf, node->intensity)) return 0;
+    if (node->is_leaf) return 1;
+
+    QTRegion children[4];
+    split_qt_region(region, children);
+    for (int i = 0; i < 4; i++)
+    {
+        if (children[i].width > 0 && !write_coded_qt_subtree(writer, node->children[i], children[i])) return 0;
+    }
+    return 1;
+}
+
+int save_coded_qt(QTNode *root, char *filename)
+{
+    if (!root) return 0;
+    QTCodedWriter *writer = open_coded_qt_writer(filename, root->width, root->height);
+    if (!writer) return 0;
+    QTRegion region = {0, 0, root->width, root->height};
+    int ok = write_coded_qt_subtree(writer, root, region);
+    if (!close_coded_qt_writer(writer)) ok = 0;
+    if (!ok) ERROR("Failed to write coded quadtree %s", filename);
+    return ok;
+}
+
+static QTNode *read_coded_qt_subtree(QTCodedReader *reader)
+{
+    QTRegion region;
+    int is_leaf;
+    unsigned char intensity;
+    if (!read_coded_qt_node(reader, &region, &is_leaf, &intensity)) return NULL;
+
+    QTNode *node = (QTNode *)malloc(sizeof(QTNode));
+    if (!node)
+    {
+        ERROR("Memory allocation failed for QTNode");
+        reader->failed = 1;
+        return NULL;
+    }
+    node->intensity = intensity;
+    node->is_leaf = is_leaf;
+    node->width = region.width;
+    node->height = region.height;
+    for (int i = 0; i < 4; i++) node->children[i] = NULL;
+    if (is_leaf) return node;
+
+    QTRegion children[4];
+    split_qt_region(region, children);
+    for (int i = 0; i < 4; i++)
+    {
+        if (children[i].width == 0) continue;
+        node->children[i] = read_coded_qt_subtree(reader);
+        if (!node->children[i])
+        {
+            delete_quadtree(node);
+            return NULL;
+        }
+    }
+    return node;
+}
+
+QTNode *load_coded_qt(char *filename)
+{
+    QTCodedReader *reader = open_coded_qt_reader(filename);
+    if (!reader) return NULL;
+    QTNode *root = read_coded_qt_subtree(reader);
+    close_coded_qt_reader(reader);
+    if (!root)
+    {
+        ERROR("Failed to load quadtree from file.");
+    }
+    return root;
+}
+
+// Streams the text preorder file node by node; the writer's own geometry tracking tells
+// when the tree is complete, so conversion stops exactly at its last node.
+int convert_preorder_qt_to_coded(char *text_filename, char *coded_filename)
+{
+    FILE *file = fopen(text_filename, "r");
+    if (!file) return 0;
+
+    QTCodedWriter *writer = NULL;
+    char node_type;
+    int intensity, row, height, col, width;
+    while ((!writer || writer->model.top > 0) &&
+           fscanf(file, " %c %d %d %d %d %d", &node_type, &intensity, &row, &height, &col, &width) == 6)
+    {
+        if (!writer && !(writer = open_coded_qt_writer(coded_filename, width, height))) break;
+        if (!write_coded_qt_node(writer, node_type == 'L', (unsigned char)intensity)) break;
+    }
+    fclose(file);
+
+    int ok = close_coded_qt_writer(writer);
+    if (!ok) ERROR("Failed to convert %s to coded", text_filename);
+    return ok;
+}
+
+int convert_coded_qt_to_preorder(char *coded_filename, char *text_filename)
+{
+    QTCodedReader *reader = open_coded_qt_reader(coded_filename);
+    if (!reader) return 0;
+    FILE *file = fopen(text_filename, "w");
+    if (!file)
+    {
+        ERROR("Failed to open file for writing.");
+        close_coded_qt_reader(reader);
+        return 0;
+    }
+
+    QTRegion region;
+    int is_leaf;
+    unsigned char intensity;
+    while (read_coded_qt_node(reader, &region, &is_leaf, &intensity))
+    {
+        fprintf(file, "%c %d %d %d %d %d\n", is_leaf ? 'L' : 'N', intensity, region.row, region.height, region.col, region.width);
+    }
+    int ok = !reader->failed;
+    if (fclose(file) != 0) ok = 0;
+    close_coded_qt_reader(reader);
+    if (!ok) ERROR("Failed to convert %s to text", coded_filename);
+    return ok;
+}
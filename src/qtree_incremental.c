@@ -0,0 +1,178 @@
+#include "qtree_incremental.h"
+#include "region_sums.h"
+#include <stdlib.h>
+
+static QTSumsNode *alloc_sums_node(void)
+{
+    QTSumsNode *sums = (QTSumsNode *)malloc(sizeof(QTSumsNode));
+    if (!sums)
+    {
+        ERROR("Memory allocation failed for QTSumsNode");
+        return NULL;
+    }
+    sums->sum = 0;
+    sums->sum_sq = 0;
+    for (int i = 0; i < 4; i++) sums->children[i] = NULL;
+    return sums;
+}
+
+static void delete_sums_tree(QTSumsNode *sums)
+{
+    if (!sums) return;
+    for (int i = 0; i < 4; i++) delete_sums_tree(sums->children[i]);
+    free(sums);
+}
+
+// Leaves partition the image, so indexing an existing tree scans every pixel once.
+static QTSumsNode *index_sums_tree(QTNode *node, Image *image, QTRegion region)
+{
+    QTSumsNode *sums = alloc_sums_node();
+    if (!sums) return NULL;
+    QTRegion children[4];
+    if (node->is_leaf || split_qt_region(region, children) == 0)
+    {
+        get_image_region_sums(image, region.col, region.row, region.width, region.height, &sums->sum, &sums->sum_sq);
+        return sums;
+    }
+    for (int i = 0; i < 4; i++)
+    {
+        if (children[i].width == 0 || !node->children[i]) continue;
+        sums->children[i] = index_sums_tree(node->children[i], image, children[i]);
+        if (!sums->children[i])
+        {
+            delete_sums_tree(sums);
+            return NULL;
+        }
+        sums->sum += sums->children[i]->sum;
+        sums->sum_sq += sums->children[i]->sum_sq;
+    }
+    return sums;
+}
+
+// create_quadtree_recursive, recording each node's sums as it goes.
+static int build_tracked_subtree(Image *image, QTRegion region, double max_rmse, QTNode **node_out, QTSumsNode **sums_out)
+{
+    QTNode *node = (QTNode *)malloc(sizeof(QTNode));
+    QTSumsNode *sums = alloc_sums_node();
+    if (!node || !sums)
+    {
+        ERROR("Memory allocation failed for QTNode");
+        free(node);
+        free(sums);
+        return 0;
+    }
+    node->width = region.width;
+    node->height = region.height;
+    for (int i = 0; i < 4; i++) node->children[i] = NULL;
+    get_image_region_sums(image, region.col, region.row, region.width, region.height, &sums->sum, &sums->sum_sq);
+    node->is_leaf = evaluate_qt_region_sums(region, sums->sum, sums->sum_sq, max_rmse, &node->intensity);
+    *node_out = node;
+    *sums_out = sums;
+    if (node->is_leaf) return 1;
+
+    QTRegion children[4];
+    split_qt_region(region, children);
+    for (int i = 0; i < 4; i++)
+    {
+        if (children[i].width > 0 && !build_tracked_subtree(image, children[i], max_rmse, &node->children[i], &sums->children[i])) return 0;
+    }
+    return 1;
+}
+
+QTIncremental *create_qt_incremental(QTNode *root, Image *image, double max_rmse)
+{
+    if (!root) return NULL;
+    QTIncremental *tracker = (QTIncremental *)malloc(sizeof(QTIncremental));
+    if (!tracker)
+    {
+        ERROR("Memory allocation failed for QTIncremental");
+        return NULL;
+    }
+    QTRegion region = {0, 0, root->width, root->height};
+    tracker->root = root;
+    tracker->max_rmse = max_rmse;
+    tracker->sums = index_sums_tree(root, image, region);
+    if (!tracker->sums)
+    {
+        free(tracker);
+        return NULL;
+    }
+    return tracker;
+}
+
+static int regions_overlap(QTRegion a, QTRegion b)
+{
+    return a.row < b.row + b.height && b.row < a.row + a.height && a.col < b.col + b.width && b.col < a.col + a.width;
+}
+
+// Subtrees outside the dirty rectangle saw no pixel change, so the builder would make the
+// same decisions there and they are kept as they are. Old leaves touching the edit are
+// rebuilt; old internal nodes are re-decided from their updated children's sums and
+// collapse into a leaf when the edit made their region uniform.
+static int update_tracked_subtree(QTIncremental *tracker, Image *image, QTNode **node_slot, QTSumsNode **sums_slot, QTRegion region, QTRegion dirty)
+{
+    if (!regions_overlap(region, dirty)) return 1;
+
+    QTNode *node = *node_slot;
+    QTSumsNode *sums = *sums_slot;
+    QTRegion children[4];
+    if (node->is_leaf || split_qt_region(region, children) == 0)
+    {
+        QTNode *rebuilt = NULL;
+        QTSumsNode *rebuilt_sums = NULL;
+        if (!build_tracked_subtree(image, region, tracker->max_rmse, &rebuilt, &rebuilt_sums))
+        {
+            delete_quadtree(rebuilt);
+            delete_sums_tree(rebuilt_sums);
+            return 0;
+        }
+        delete_quadtree(node);
+        delete_sums_tree(sums);
+        *node_slot = rebuilt;
+        *sums_slot = rebuilt_sums;
+        return 1;
+    }
+
+    unsigned long long sum = 0, sum_sq = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        if (children[i].width == 0) continue;
+        if (!update_tracked_subtree(tracker, image, &node->children[i], &sums->children[i], children[i], dirty)) return 0;
+        sum += sums->children[i]->sum;
+        sum_sq += sums->children[i]->sum_sq;
+    }
+    sums->sum = sum;
+    sums->sum_sq = sum_sq;
+
+    if (evaluate_qt_region_sums(region, sum, sum_sq, tracker->max_rmse, &node->intensity))
+    {
+        for (int i = 0; i < 4; i++)
+        {
+            delete_quadtree(node->children[i]);
+            delete_sums_tree(sums->children[i]);
+            node->children[i] = NULL;
+            sums->children[i] = NULL;
+        }
+        node->is_leaf = 1;
+    }
+    return 1;
+}
+
+// `image` must be the tracked image with only pixels inside `dirty` changed since the
+// last update. On failure the tracker is left inconsistent and should be deleted.
+int update_qt_incremental(QTIncremental *tracker, Image *image, QTRegion dirty)
+{
+    if (!tracker || (int)image->width != tracker->root->width || (int)image->height != tracker->root->height) return 0;
+    QTRegion region = {0, 0, tracker->root->width, tracker->root->height};
+    return update_tracked_subtree(tracker, image, &tracker->root, &tracker->sums, region, dirty);
+}
+
+void delete_qt_incremental(QTIncremental *tracker)
+{
+    if (tracker)
+    {
+        delete_quadtree(tracker->root);
+        delete_sums_tree(tracker->sums);
+        free(tracker);
+    }
+}
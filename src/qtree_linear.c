@@ -0,0 +1,268 @@
+#include "qtree_linear.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define LINEAR_QT_STACK_SIZE 256
+
+static unsigned int count_nodes(QTNode *node, QTRegion region)
+{
+    if (!node) return 0;
+    if (node->is_leaf) return 1;
+    QTRegion children[4];
+    split_qt_region(region, children);
+    unsigned int count = 1;
+    for (int i = 0; i < 4; i++)
+    {
+        if (children[i].width > 0) count += count_nodes(node->children[i], children[i]);
+    }
+    return count;
+}
+
+static int fill_linear_nodes(QTNode *node, QTRegion region, LinearQTNode *nodes, unsigned int *next)
+{
+    if (!node) return 0;
+    unsigned int index = (*next)++;
+    nodes[index].intensity = node->intensity;
+    nodes[index].is_leaf = node->is_leaf ? 1 : 0;
+    if (!node->is_leaf)
+    {
+        QTRegion children[4];
+        if (split_qt_region(region, children) == 0) return 0;
+        for (int i = 0; i < 4; i++)
+        {
+            if (children[i].width > 0 && !fill_linear_nodes(node->children[i], children[i], nodes, next)) return 0;
+        }
+    }
+    nodes[index].end = *next;
+    return 1;
+}
+
+LinearQTree *linearize_quadtree(QTNode *root)
+{
+    if (!root) return NULL;
+
+    LinearQTree *tree = (LinearQTree *)malloc(sizeof(LinearQTree));
+    if (!tree)
+    {
+        ERROR("Memory allocation failed for LinearQTree");
+        return NULL;
+    }
+    QTRegion region = {0, 0, root->width, root->height};
+    tree->width = root->width;
+    tree->height = root->height;
+    tree->node_count = count_nodes(root, region);
+    tree->nodes = (LinearQTNode *)malloc(tree->node_count * sizeof(LinearQTNode));
+    if (!tree->nodes)
+    {
+        ERROR("Memory allocation failed for LinearQTree nodes");
+        free(tree);
+        return NULL;
+    }
+
+    unsigned int next = 0;
+    if (!fill_linear_nodes(root, region, tree->nodes, &next) || next != tree->node_count)
+    {
+        ERROR("Quadtree is missing children required by its geometry");
+        delete_linear_qtree(tree);
+        return NULL;
+    }
+    return tree;
+}
+
+static QTNode *delinearize_node(LinearQTree *tree, unsigned int index, QTRegion region)
+{
+    QTNode *node = (QTNode *)malloc(sizeof(QTNode));
+    if (!node)
+    {
+        ERROR("Memory allocation failed for QTNode");
+        return NULL;
+    }
+    LinearQTNode *linear = &tree->nodes[index];
+    node->intensity = linear->intensity;
+    node->is_leaf = linear->is_leaf;
+    node->width = region.width;
+    node->height = region.height;
+    for (int i = 0; i < 4; i++) node->children[i] = NULL;
+    if (linear->is_leaf) return node;
+
+    QTRegion children[4];
+    split_qt_region(region, children);
+    unsigned int child = index + 1;
+    for (int i = 0; i < 4; i++)
+    {
+        if (children[i].width == 0) continue;
+        node->children[i] = delinearize_node(tree, child, children[i]);
+        if (!node->children[i])
+        {
+            delete_quadtree(node);
+            return NULL;
+        }
+        child = tree->nodes[child].end;
+    }
+    return node;
+}
+
+QTNode *delinearize_quadtree(LinearQTree *tree)
+{
+    if (!tree || tree->node_count == 0) return NULL;
+    QTRegion region = {0, 0, tree->width, tree->height};
+    return delinearize_node(tree, 0, region);
+}
+
+void delete_linear_qtree(LinearQTree *tree)
+{
+    if (tree)
+    {
+        free(tree->nodes);
+        free(tree);
+    }
+}
+
+// Visits nodes strictly in array order, re-deriving each region from an explicit stack.
+unsigned char *render_linear_qtree(LinearQTree *tree)
+{
+    if (!tree) return NULL;
+    unsigned char *pixels = (unsigned char *)malloc((size_t)tree->width * tree->height);
+    if (!pixels)
+    {
+        ERROR("Memory allocation failed for rendered quadtree");
+        return NULL;
+    }
+
+    QTRegion stack[LINEAR_QT_STACK_SIZE];
+    int top = 0;
+    stack[top++] = (QTRegion){0, 0, tree->width, tree->height};
+    for (unsigned int i = 0; i < tree->node_count && top > 0; i++)
+    {
+        QTRegion region = stack[--top];
+        LinearQTNode *node = &tree->nodes[i];
+        if (node->is_leaf)
+        {
+            for (int row = region.row; row < region.row + region.height; row++)
+            {
+                memset(pixels + (size_t)row * tree->width + region.col, node->intensity, (size_t)region.width);
+            }
+            continue;
+        }
+        QTRegion children[4];
+        split_qt_region(region, children);
+        for (int child = 3; child >= 0; child--)
+        {
+            if (children[child].width > 0) stack[top++] = children[child];
+        }
+    }
+    return pixels;
+}
+
+// Returns 1 once the rendered image is written, 0 otherwise.
+int save_linear_qtree_as_ppm(LinearQTree *tree, char *filename, ImageFormat format)
+{
+    unsigned char *pixels = render_linear_qtree(tree);
+    if (!pixels) return 0;
+    Image image = {(unsigned int)tree->width, (unsigned int)tree->height, 1, pixels};
+    int ok = save_image(&image, filename, format);
+    free(pixels);
+    return ok;
+}
+
+// Returns 1 once the whole file is written and closed, 0 otherwise.
+int save_linear_preorder_qt(LinearQTree *tree, char *filename)
+{
+    FILE *file = fopen(filename, "w");
+    if (!file)
+    {
+        ERROR("Failed to open file for writing.");
+        return 0;
+    }
+
+    QTRegion stack[LINEAR_QT_STACK_SIZE];
+    int top = 0;
+    stack[top++] = (QTRegion){0, 0, tree->width, tree->height};
+    for (unsigned int i = 0; i < tree->node_count && top > 0; i++)
+    {
+        QTRegion region = stack[--top];
+        LinearQTNode *node = &tree->nodes[i];
+        fprintf(file, "%c %d %d %d %d %d\n", node->is_leaf ? 'L' : 'N', node->intensity, region.row, region.height, region.col, region.width);
+        if (node->is_leaf) continue;
+        QTRegion children[4];
+        split_qt_region(region, children);
+        for (int child = 3; child >= 0; child--)
+        {
+            if (children[child].width > 0) stack[top++] = children[child];
+        }
+    }
+    int ok = !ferror(file);
+    if (fclose(file) != 0) ok = 0;
+    if (!ok) ERROR("Failed to write quadtree %s", filename);
+    return ok;
+}
+
+LinearQTree *load_linear_preorder_qt(char *filename)
+{
+    FILE *file = fopen(filename, "r");
+    if (!file) return NULL;
+
+    LinearQTree *tree = (LinearQTree *)malloc(sizeof(LinearQTree));
+    unsigned int capacity = 1024;
+    LinearQTNode *nodes = (LinearQTNode *)malloc(capacity * sizeof(LinearQTNode));
+    if (!tree || !nodes)
+    {
+        ERROR("Memory allocation failed for LinearQTree");
+        free(tree);
+        free(nodes);
+        fclose(file);
+        return NULL;
+    }
+
+    // Open internal nodes and how many of their children are still to come.
+    unsigned int open_index[LINEAR_QT_STACK_SIZE];
+    int open_remaining[LINEAR_QT_STACK_SIZE];
+    int top = 0;
+    unsigned int count = 0;
+    char node_type;
+    int intensity, row, height, col, width;
+    while ((count == 0 || top > 0) &&
+           fscanf(file, " %c %d %d %d %d %d", &node_type, &intensity, &row, &height, &col, &width) == 6)
+    {
+        if (count == capacity)
+        {
+            capacity *= 2;
+            LinearQTNode *grown = (LinearQTNode *)realloc(nodes, capacity * sizeof(LinearQTNode));
+            if (!grown) break;
+            nodes = grown;
+        }
+        if (count == 0)
+        {
+            tree->width = width;
+            tree->height = height;
+        }
+        if (top > 0) open_remaining[top - 1]--;
+
+        unsigned int index = count++;
+        nodes[index].intensity = (unsigned char)intensity;
+        nodes[index].is_leaf = node_type == 'L';
+        nodes[index].end = count;
+        if (!nodes[index].is_leaf && top < LINEAR_QT_STACK_SIZE)
+        {
+            open_index[top] = index;
+            open_remaining[top++] = (width > 1 && height > 1) ? 4 : 2;
+            continue;
+        }
+        while (top > 0 && open_remaining[top - 1] == 0)
+        {
+            nodes[open_index[--top]].end = count;
+        }
+    }
+    fclose(file);
+
+    if (count == 0 || top > 0)
+    {
+        ERROR("Failed to load quadtree from file.");
+        free(nodes);
+        free(tree);
+        return NULL;
+    }
+    tree->node_count = count;
+    tree->nodes = nodes;
+    return tree;
+}
@@ -0,0 +1,226 @@
+#include "qtree_mapped.h"
+#include "qtree_linear.h"
+#include <fcntl.h>
+#include <limits.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static void put_u32(unsigned char *out, unsigned int value)
+{
+    for (int i = 0; i < 4; i++) out[i] = (unsigned char)(value >> (8 * i));
+}
+
+static unsigned int get_u32(const unsigned char *in)
+{
+    return (unsigned int)in[0] | (unsigned int)in[1] << 8 | (unsigned int)in[2] << 16 | (unsigned int)in[3] << 24;
+}
+
+int save_mapped_qt(QTNode *root, char *filename)
+{
+    LinearQTree *tree = linearize_quadtree(root);
+    if (!tree) return 0;
+    FILE *file = fopen(filename, "wb");
+    if (!file)
+    {
+        ERROR("Failed to open file %s for writing", filename);
+        delete_linear_qtree(tree);
+        return 0;
+    }
+
+    unsigned char buffer[8192];
+    memcpy(buffer, QT_MAPPED_MAGIC, 3);
+    buffer[3] = QT_MAPPED_VERSION;
+    put_u32(buffer + 4, (unsigned int)tree->width);
+    put_u32(buffer + 8, (unsigned int)tree->height);
+    put_u32(buffer + 12, tree->node_count);
+    size_t used = QT_MAPPED_HEADER_SIZE;
+    int ok = 1;
+    for (unsigned int i = 0; ok && i < tree->node_count; i++)
+    {
+        if (used + QT_MAPPED_ENTRY_SIZE > sizeof(buffer))
+        {
+            ok = fwrite(buffer, 1, used, file) == used;
+            used = 0;
+        }
+        unsigned char *entry = buffer + used;
+        put_u32(entry, tree->nodes[i].end);
+        entry[4] = tree->nodes[i].intensity;
+        entry[5] = tree->nodes[i].is_leaf;
+        entry[6] = entry[7] = 0;
+        used += QT_MAPPED_ENTRY_SIZE;
+    }
+    if (ok && used > 0) ok = fwrite(buffer, 1, used, file) == used;
+    if (fclose(file) != 0) ok = 0;
+    delete_linear_qtree(tree);
+    if (!ok) ERROR("Failed to write mapped quadtree %s", filename);
+    return ok;
+}
+
+// Only the header is validated, so opening costs the same for every file size.
+MappedQTree *open_mapped_qt(char *filename)
+{
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) return NULL;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < QT_MAPPED_HEADER_SIZE)
+    {
+        close(fd);
+        return NULL;
+    }
+    void *mapping = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED)
+    {
+        ERROR("Failed to map %s", filename);
+        return NULL;
+    }
+
+    const unsigned char *header = (const unsigned char *)mapping;
+    unsigned int width = get_u32(header + 4);
+    unsigned int height = get_u32(header + 8);
+    unsigned int node_count = get_u32(header + 12);
+    if (memcmp(header, QT_MAPPED_MAGIC, 3) != 0 || header[3] != QT_MAPPED_VERSION || node_count == 0 ||
+        width == 0 || height == 0 || width > INT_MAX || height > INT_MAX ||
+        (size_t)st.st_size < QT_MAPPED_HEADER_SIZE + (size_t)node_count * QT_MAPPED_ENTRY_SIZE)
+    {
+        ERROR("%s is not a version %d mapped quadtree", filename, QT_MAPPED_VERSION);
+        munmap(mapping, (size_t)st.st_size);
+        return NULL;
+    }
+
+    MappedQTree *tree = (MappedQTree *)malloc(sizeof(MappedQTree));
+    if (!tree)
+    {
+        ERROR("Memory allocation failed for MappedQTree");
+        munmap(mapping, (size_t)st.st_size);
+        return NULL;
+    }
+    madvise(mapping, (size_t)st.st_size, MADV_RANDOM);
+    tree->width = (int)width;
+    tree->height = (int)height;
+    tree->node_count = node_count;
+    tree->entries = header + QT_MAPPED_HEADER_SIZE;
+    tree->mapping = mapping;
+    tree->mapping_size = (size_t)st.st_size;
+    return tree;
+}
+
+void close_mapped_qt(MappedQTree *tree)
+{
+    if (tree)
+    {
+        munmap(tree->mapping, tree->mapping_size);
+        free(tree);
+    }
+}
+
+static const unsigned char *mapped_entry(MappedQTree *tree, unsigned int index)
+{
+    return tree->entries + (size_t)index * QT_MAPPED_ENTRY_SIZE;
+}
+
+MappedQTNode get_mapped_root(MappedQTree *tree)
+{
+    MappedQTNode root = {0, {0, 0, tree->width, tree->height}};
+    return root;
+}
+
+// Siblings are reached by following `end` links, so at most three entries are read
+// besides the child itself. Corrupt links yield QT_MAPPED_NONE instead of reading past the map.
+MappedQTNode get_mapped_child(MappedQTree *tree, MappedQTNode node, int slot)
+{
+    MappedQTNode child = {QT_MAPPED_NONE, {node.region.row, node.region.col, 0, 0}};
+    if (node.index >= tree->node_count || slot < 0 || slot > 3 || mapped_entry(tree, node.index)[5]) return child;
+
+    QTRegion children[4];
+    split_qt_region(node.region, children);
+    if (children[slot].width == 0) return child;
+
+    unsigned int index = node.index + 1;
+    for (int i = 0; i < slot && index < tree->node_count; i++)
+    {
+        if (children[i].width > 0) index = get_u32(mapped_entry(tree, index));
+    }
+    if (index < tree->node_count)
+    {
+        child.index = index;
+        child.region = children[slot];
+    }
+    return child;
+}
+
+MappedQTNode get_mapped_child1(MappedQTree *tree, MappedQTNode node)
+{
+    return get_mapped_child(tree, node, 0);
+}
+MappedQTNode get_mapped_child2(MappedQTree *tree, MappedQTNode node)
+{
+    return get_mapped_child(tree, node, 1);
+}
+MappedQTNode get_mapped_child3(MappedQTree *tree, MappedQTNode node)
+{
+    return get_mapped_child(tree, node, 2);
+}
+MappedQTNode get_mapped_child4(MappedQTree *tree, MappedQTNode node)
+{
+    return get_mapped_child(tree, node, 3);
+}
+
+int is_mapped_leaf(MappedQTree *tree, MappedQTNode node)
+{
+    return node.index < tree->node_count ? mapped_entry(tree, node.index)[5] : 0;
+}
+
+unsigned char get_mapped_intensity(MappedQTree *tree, MappedQTNode node)
+{
+    return node.index < tree->node_count ? mapped_entry(tree, node.index)[4] : 0;
+}
+
+// Descends with the same split rules as the builder; returns 0 outside the image.
+unsigned char query_mapped_qt_point(MappedQTree *tree, int row, int col)
+{
+    if (!tree || row < 0 || col < 0 || row >= tree->height || col >= tree->width) return 0;
+    MappedQTNode node = get_mapped_root(tree);
+    while (node.index != QT_MAPPED_NONE && !is_mapped_leaf(tree, node))
+    {
+        int slot = (row >= node.region.row + node.region.height / 2 && node.region.height > 1 ? 2 : 0) +
+                   (col >= node.region.col + node.region.width / 2 && node.region.width > 1 ? 1 : 0);
+        MappedQTNode child = get_mapped_child(tree, node, slot);
+        if (child.index == QT_MAPPED_NONE) break;
+        node = child;
+    }
+    return get_mapped_intensity(tree, node);
+}
+
+QTNode *materialize_mapped_subtree(MappedQTree *tree, MappedQTNode node)
+{
+    if (node.index >= tree->node_count) return NULL;
+    QTNode *qtnode = (QTNode *)malloc(sizeof(QTNode));
+    if (!qtnode)
+    {
+        ERROR("Memory allocation failed for QTNode");
+        return NULL;
+    }
+    qtnode->intensity = get_mapped_intensity(tree, node);
+    qtnode->is_leaf = is_mapped_leaf(tree, node);
+    qtnode->width = node.region.width;
+    qtnode->height = node.region.height;
+    for (int i = 0; i < 4; i++) qtnode->children[i] = NULL;
+    if (qtnode->is_leaf) return qtnode;
+
+    QTRegion children[4];
+    split_qt_region(node.region, children);
+    for (int i = 0; i < 4; i++)
+    {
+        if (children[i].width == 0) continue;
+        qtnode->children[i] = materialize_mapped_subtree(tree, get_mapped_child(tree, node, i));
+        if (!qtnode->children[i])
+        {
+            delete_quadtree(qtnode);
+            return NULL;
+        }
+    }
+    return qtnode;
+}
@@ -0,0 +1,158 @@
+#include <pthread.h>
+#include <stdlib.h>
+#include "qtree.h"
+#include "qtree_stats.h"
+
+#define QT_PARALLEL_DEFAULT_CUTOFF (64 * 64)
+
+typedef struct QTBuildTask
+{
+    QTRegion region;
+    QTNode **slot;
+} QTBuildTask;
+
+// Every task writes exactly one child slot, so the finished tree does not depend on
+// which thread ran which task and is identical to the serial build.
+typedef struct QTBuildPool
+{
+    Image *image;
+    double max_rmse;
+    long long serial_cutoff;
+    QTBuildTask *tasks;
+    size_t task_count;
+    size_t task_capacity;
+    size_t pending;
+    int failed;
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+} QTBuildPool;
+
+static void push_task(QTBuildPool *pool, QTRegion region, QTNode **slot)
+{
+    if (pool->task_count == pool->task_capacity)
+    {
+        size_t capacity = pool->task_capacity ? 2 * pool->task_capacity : 64;
+        QTBuildTask *grown = (QTBuildTask *)realloc(pool->tasks, capacity * sizeof(QTBuildTask));
+        if (!grown)
+        {
+            ERROR("Memory allocation failed for quadtree build tasks");
+            pool->failed = 1;
+            return;
+        }
+        pool->tasks = grown;
+        pool->task_capacity = capacity;
+    }
+    pool->tasks[pool->task_count].region = region;
+    pool->tasks[pool->task_count].slot = slot;
+    pool->task_count++;
+    pool->pending++;
+}
+
+static void mark_failed(QTBuildPool *pool)
+{
+    pthread_mutex_lock(&pool->lock);
+    pool->failed = 1;
+    pthread_mutex_unlock(&pool->lock);
+}
+
+static void run_task(QTBuildPool *pool, QTBuildTask task)
+{
+    if ((long long)task.region.width * task.region.height <= pool->serial_cutoff)
+    {
+        *task.slot = create_quadtree_region(pool->image, task.region, pool->max_rmse);
+        if (!*task.slot) mark_failed(pool);
+        return;
+    }
+
+    QTNode *node = (QTNode *)malloc(sizeof(QTNode));
+    if (!node)
+    {
+        ERROR("Memory allocation failed for QTNode");
+        *task.slot = NULL;
+        mark_failed(pool);
+        return;
+    }
+    node->width = task.region.width;
+    node->height = task.region.height;
+    for (int i = 0; i < 4; i++) node->children[i] = NULL;
+    node->is_leaf = evaluate_qt_region(pool->image, task.region, pool->max_rmse, &node->intensity);
+    *task.slot = node;
+    if (node->is_leaf) return;
+
+    QTRegion children[4];
+    split_qt_region(task.region, children);
+    pthread_mutex_lock(&pool->lock);
+    for (int i = 0; i < 4; i++)
+    {
+        if (children[i].width > 0) push_task(pool, children[i], &node->children[i]);
+    }
+    pthread_cond_broadcast(&pool->changed);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+static void *build_worker(void *arg)
+{
+    QTBuildPool *pool = (QTBuildPool *)arg;
+    pthread_mutex_lock(&pool->lock);
+    while (1)
+    {
+        while (pool->task_count == 0 && pool->pending > 0)
+        {
+            pthread_cond_wait(&pool->changed, &pool->lock);
+        }
+        if (pool->task_count == 0) break;
+
+        QTBuildTask task = pool->tasks[--pool->task_count];
+        pthread_mutex_unlock(&pool->lock);
+        run_task(pool, task);
+        pthread_mutex_lock(&pool->lock);
+
+        if (--pool->pending == 0) pthread_cond_broadcast(&pool->changed);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+QTNode *create_quadtree_parallel(Image *image, double max_rmse, int num_threads, int serial_cutoff_pixels)
+{
+    if (num_threads <= 1) return create_quadtree(image, max_rmse);
+    QT_STATS_START(start);
+
+    QTBuildPool pool;
+    pool.image = image;
+    pool.max_rmse = max_rmse;
+    pool.serial_cutoff = serial_cutoff_pixels > 0 ? serial_cutoff_pixels : QT_PARALLEL_DEFAULT_CUTOFF;
+    pool.tasks = NULL;
+    pool.task_count = 0;
+    pool.task_capacity = 0;
+    pool.pending = 0;
+    pool.failed = 0;
+    pthread_mutex_init(&pool.lock, NULL);
+    pthread_cond_init(&pool.changed, NULL);
+
+    QTNode *root = NULL;
+    QTRegion region = {0, 0, image->width, image->height};
+    push_task(&pool, region, &root);
+
+    pthread_t *threads = (pthread_t *)malloc((size_t)(num_threads - 1) * sizeof(pthread_t));
+    int started = 0;
+    while (threads && started < num_threads - 1 && pthread_create(&threads[started], NULL, build_worker, &pool) == 0)
+    {
+        started++;
+    }
+    build_worker(&pool);
+    for (int i = 0; i < started; i++) pthread_join(threads[i], NULL);
+    free(threads);
+
+    free(pool.tasks);
+    pthread_mutex_destroy(&pool.lock);
+    pthread_cond_destroy(&pool.changed);
+    if (pool.failed)
+    {
+        delete_quadtree(root);
+        return NULL;
+    }
+    QT_STATS_PHASE(QT_STATS_BUILD, start);
+    QT_STATS_TREE(root);
+    return root;
+}
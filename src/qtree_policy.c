@@ -0,0 +1,233 @@
+#include <math.h>
+#include <stdlib.h>
+#include "qtree_policy.h"
+#include "qtree_stats.h"
+#include "region_sums.h"
+
+// A leaf the best-first build may still split, ordered by squared error and then by the
+// order it was found in, so equal errors always split in the same order.
+typedef struct QTSplitCandidate
+{
+    unsigned long long priority;
+    unsigned long long order;
+    QTNode *node;
+    QTRegion region;
+    int depth;
+} QTSplitCandidate;
+
+typedef struct QTSplitHeap
+{
+    QTSplitCandidate *items;
+    size_t count;
+    size_t capacity;
+} QTSplitHeap;
+
+void init_qt_split_policy(QTSplitPolicy *policy, QTSplitRule rule, double threshold)
+{
+    policy->rule = rule;
+    policy->threshold = threshold;
+    policy->min_block_size = 0;
+    policy->max_depth = 0;
+    policy->node_budget = 0;
+}
+
+// Whether every pixel lies within threshold of the intensity, checking one row's range at
+// a time so a region with an outlier near its top is rejected after a few rows. Like
+// get_image_intensity, it reads the first channel of multi-channel images.
+static int within_deviation(Image *image, QTRegion region, unsigned char intensity, double threshold)
+{
+    double low = ceil((double)intensity - threshold);
+    double high = floor((double)intensity + threshold);
+    if (low <= 0 && high >= 255) return 1;
+    size_t stride = image->channels;
+    for (int row = region.row; row < region.row + region.height; row++)
+    {
+        const unsigned char *pixels = image->data + ((size_t)row * image->width + region.col) * stride;
+        unsigned char row_min = 255, row_max = 0;
+        for (int col = 0; col < region.width; col++)
+        {
+            unsigned char value = pixels[(size_t)col * stride];
+            row_min = value < row_min ? value : row_min;
+            row_max = value > row_max ? value : row_max;
+        }
+        if (row_min < low || row_max > high)
+        {
+            QT_STATS_SCAN(region.width, region.height, (unsigned long long)region.width * (row - region.row + 1));
+            return 0;
+        }
+    }
+    QT_STATS_SCAN(region.width, region.height, (unsigned long long)region.width * region.height);
+    return 1;
+}
+
+// Computes a region's truncated mean and squared error around it, and reports whether
+// the policy makes it a leaf at the given depth. 1x1 regions are always leaves. The
+// squared error is exact: sum_sq - 2 * mean * sum + mean^2 * pixel_count in integers.
+int evaluate_qt_region_policy(Image *image, QTRegion region, int depth, QTSplitPolicy *policy, unsigned char *intensity,
+                              unsigned long long *squared_error)
+{
+    unsigned long long sum, sum_sq;
+    get_image_region_sums(image, region.col, region.row, region.width, region.height, &sum, &sum_sq);
+    double rmse = calculate_qt_region_rmse(region, sum, sum_sq, intensity);
+    if (squared_error)
+    {
+        unsigned long long pixel_count = (unsigned long long)region.width * region.height;
+        *squared_error = sum_sq - 2ULL * *intensity * sum + (unsigned long long)*intensity * *intensity * pixel_count;
+    }
+
+    if (region.width <= 1 && region.height <= 1) return 1;
+    if (policy->min_block_size > 0 && region.width <= policy->min_block_size && region.height <= policy->min_block_size) return 1;
+    if (policy->max_depth > 0 && depth >= policy->max_depth) return 1;
+    if (policy->rule == QT_SPLIT_RMSE) return rmse <= policy->threshold;
+    return within_deviation(image, region, *intensity, policy->threshold);
+}
+
+static QTNode *new_policy_node(QTRegion region)
+{
+    QTNode *node = (QTNode *)malloc(sizeof(QTNode));
+    if (!node)
+    {
+        ERROR("Memory allocation failed for QTNode");
+        return NULL;
+    }
+    for (int i = 0; i < 4; i++) node->children[i] = NULL;
+    node->width = region.width;
+    node->height = region.height;
+    node->is_leaf = 1;
+    return node;
+}
+
+static QTNode *create_quadtree_policy_recursive(Image *image, QTRegion region, int depth, QTSplitPolicy *policy)
+{
+    QTNode *node = new_policy_node(region);
+    if (!node) return NULL;
+    node->is_leaf = evaluate_qt_region_policy(image, region, depth, policy, &node->intensity, NULL);
+    if (node->is_leaf) return node;
+
+    QTRegion children[4];
+    split_qt_region(region, children);
+    for (int i = 0; i < 4; i++)
+    {
+        if (children[i].width == 0) continue;
+        node->children[i] = create_quadtree_policy_recursive(image, children[i], depth + 1, policy);
+        if (!node->children[i])
+        {
+            delete_quadtree(node);
+            return NULL;
+        }
+    }
+    return node;
+}
+
+static int candidate_before(QTSplitCandidate *a, QTSplitCandidate *b)
+{
+    return a->priority > b->priority || (a->priority == b->priority && a->order < b->order);
+}
+
+static int push_split_candidate(QTSplitHeap *heap, QTSplitCandidate candidate)
+{
+    if (heap->count == heap->capacity)
+    {
+        size_t capacity = heap->capacity ? 2 * heap->capacity : 64;
+        QTSplitCandidate *grown = (QTSplitCandidate *)realloc(heap->items, capacity * sizeof(QTSplitCandidate));
+        if (!grown)
+        {
+            ERROR("Memory allocation failed for split candidates");
+            return 0;
+        }
+        heap->items = grown;
+        heap->capacity = capacity;
+    }
+    size_t i = heap->count++;
+    while (i > 0 && candidate_before(&candidate, &heap->items[(i - 1) / 2]))
+    {
+        heap->items[i] = heap->items[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    heap->items[i] = candidate;
+    return 1;
+}
+
+static QTSplitCandidate pop_split_candidate(QTSplitHeap *heap)
+{
+    QTSplitCandidate top = heap->items[0];
+    QTSplitCandidate last = heap->items[--heap->count];
+    size_t i = 0;
+    while (2 * i + 1 < heap->count)
+    {
+        size_t child = 2 * i + 1;
+        if (child + 1 < heap->count && candidate_before(&heap->items[child + 1], &heap->items[child])) child++;
+        if (!candidate_before(&heap->items[child], &last)) break;
+        heap->items[i] = heap->items[child];
+        i = child;
+    }
+    heap->items[i] = last;
+    return top;
+}
+
+// Starts from the root as a single leaf and repeatedly splits the splittable leaf with the
+// largest squared error. A leaf whose split would pass the budget stays a leaf and the
+// next one is tried, since a split into two children may still fit where four do not;
+// the build ends when no leaf is left to split.
+static QTNode *create_quadtree_best_first(Image *image, QTSplitPolicy *policy)
+{
+    QTRegion root_region = {0, 0, (int)image->width, (int)image->height};
+    QTNode *root = new_policy_node(root_region);
+    if (!root) return NULL;
+
+    QTSplitHeap heap = {NULL, 0, 0};
+    unsigned long long order = 0;
+    QTSplitCandidate candidate = {0, order++, root, root_region, 0};
+    int failed = !evaluate_qt_region_policy(image, root_region, 0, policy, &root->intensity, &candidate.priority) &&
+                 !push_split_candidate(&heap, candidate);
+    unsigned long long node_count = 1;
+
+    // Every split adds at least two nodes.
+    while (!failed && heap.count > 0 && node_count + 2 <= policy->node_budget)
+    {
+        QTSplitCandidate best = pop_split_candidate(&heap);
+        QTRegion children[4];
+        int child_count = split_qt_region(best.region, children);
+        if (node_count + (unsigned long long)child_count > policy->node_budget) continue;
+
+        best.node->is_leaf = 0;
+        node_count += (unsigned long long)child_count;
+        for (int i = 0; !failed && i < 4; i++)
+        {
+            if (children[i].width == 0) continue;
+            QTNode *child = new_policy_node(children[i]);
+            best.node->children[i] = child;
+            if (!child)
+            {
+                failed = 1;
+                break;
+            }
+            QTSplitCandidate next = {0, order++, child, children[i], best.depth + 1};
+            if (!evaluate_qt_region_policy(image, children[i], next.depth, policy, &child->intensity, &next.priority))
+            {
+                failed = !push_split_candidate(&heap, next);
+            }
+        }
+    }
+
+    free(heap.items);
+    if (failed)
+    {
+        delete_quadtree(root);
+        return NULL;
+    }
+    return root;
+}
+
+// Builds a quadtree under a split policy; see QTSplitPolicy for how the rule and limits
+// combine. Without a node budget the build is depth-first like create_quadtree.
+QTNode *create_quadtree_policy(Image *image, QTSplitPolicy *policy)
+{
+    QT_STATS_START(start);
+    QTRegion region = {0, 0, (int)image->width, (int)image->height};
+    QTNode *root = policy->node_budget > 0 ? create_quadtree_best_first(image, policy)
+                                           : create_quadtree_policy_recursive(image, region, 0, policy);
+    QT_STATS_PHASE(QT_STATS_BUILD, start);
+    QT_STATS_TREE(root);
+    return root;
+}
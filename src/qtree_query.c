@@ -0,0 +1,225 @@
+#include "qtree_query.h"
+#include <stdlib.h>
+
+#define QT_QUERY_STACK_SIZE 64
+
+// Child slot containing (row, col), using the builder's half-width/half-height split.
+static int child_slot(QTRegion region, int row, int col)
+{
+    return (region.height > 1 && row >= region.row + region.height / 2 ? 2 : 0) +
+           (region.width > 1 && col >= region.col + region.width / 2 ? 1 : 0);
+}
+
+static int region_contains(QTRegion region, int row, int col)
+{
+    return row >= region.row && row < region.row + region.height && col >= region.col && col < region.col + region.width;
+}
+
+// Returns 0 outside the tree, like get_image_intensity outside the image.
+unsigned char query_qt_point(QTNode *root, int row, int col)
+{
+    if (!root) return 0;
+    QTRegion region = {0, 0, root->width, root->height};
+    if (!region_contains(region, row, col)) return 0;
+
+    QTNode *node = root;
+    while (!node->is_leaf)
+    {
+        QTRegion children[4];
+        if (split_qt_region(region, children) == 0) break;
+        int slot = child_slot(region, row, col);
+        if (!node->children[slot]) break;
+        node = node->children[slot];
+        region = children[slot];
+    }
+    return node->intensity;
+}
+
+typedef struct QTRegionQuery
+{
+    QTRegion query;
+    QTRegionStats *stats;
+    unsigned long long weighted_sum;
+    QTNode **leaves;
+    size_t leaf_capacity;
+    int failed;
+} QTRegionQuery;
+
+static QTRegion intersect_regions(QTRegion a, QTRegion b)
+{
+    int top = a.row > b.row ? a.row : b.row;
+    int left = a.col > b.col ? a.col : b.col;
+    int bottom = a.row + a.height < b.row + b.height ? a.row + a.height : b.row + b.height;
+    int right = a.col + a.width < b.col + b.width ? a.col + a.width : b.col + b.width;
+    QTRegion overlap = {top, left, right > left ? right - left : 0, bottom > top ? bottom - top : 0};
+    if (overlap.width == 0 || overlap.height == 0) overlap.width = overlap.height = 0;
+    return overlap;
+}
+
+static void add_covering_leaf(QTRegionQuery *state, QTNode *node, unsigned long long pixels)
+{
+    QTRegionStats *stats = state->stats;
+    if (stats->leaf_count == 0 || node->intensity < stats->min) stats->min = node->intensity;
+    if (stats->leaf_count == 0 || node->intensity > stats->max) stats->max = node->intensity;
+    stats->pixel_count += pixels;
+    state->weighted_sum += pixels * node->intensity;
+
+    if (state->leaves && stats->leaf_count == state->leaf_capacity)
+    {
+        size_t capacity = state->leaf_capacity ? 2 * state->leaf_capacity : 64;
+        QTNode **grown = (QTNode **)realloc(state->leaves, capacity * sizeof(QTNode *));
+        if (!grown)
+        {
+            ERROR("Memory allocation failed for covering leaves");
+            state->failed = 1;
+            return;
+        }
+        state->leaves = grown;
+        state->leaf_capacity = capacity;
+    }
+    if (state->leaves) state->leaves[stats->leaf_count] = node;
+    stats->leaf_count++;
+}
+
+// Subtrees whose region misses the query are never entered.
+static void query_qt_region_helper(QTRegionQuery *state, QTNode *node, QTRegion region)
+{
+    if (!node || state->failed) return;
+    QTRegion overlap = intersect_regions(region, state->query);
+    if (overlap.width == 0) return;
+
+    QTRegion children[4];
+    if (node->is_leaf || split_qt_region(region, children) == 0)
+    {
+        add_covering_leaf(state, node, (unsigned long long)overlap.width * overlap.height);
+        return;
+    }
+    for (int i = 0; i < 4; i++)
+    {
+        if (children[i].width > 0) query_qt_region_helper(state, node->children[i], children[i]);
+    }
+}
+
+// Fills stats for the part of `query` inside the tree. When leaves is not NULL it receives
+// a malloc'd array of the stats->leaf_count leaves overlapping the query, in preorder.
+int query_qt_region(QTNode *root, QTRegion query, QTRegionStats *stats, QTNode ***leaves)
+{
+    QTRegionQuery state = {query, stats, 0, NULL, 0, 0};
+    stats->pixel_count = 0;
+    stats->mean = 0.0;
+    stats->min = 0;
+    stats->max = 0;
+    stats->leaf_count = 0;
+    if (leaves)
+    {
+        *leaves = NULL;
+        state.leaves = (QTNode **)malloc(64 * sizeof(QTNode *));
+        state.leaf_capacity = 64;
+        if (!state.leaves)
+        {
+            ERROR("Memory allocation failed for covering leaves");
+            return 0;
+        }
+    }
+    if (root)
+    {
+        QTRegion region = {0, 0, root->width, root->height};
+        query_qt_region_helper(&state, root, region);
+    }
+    if (state.failed)
+    {
+        free(state.leaves);
+        return 0;
+    }
+
+    if (stats->pixel_count > 0) stats->mean = (double)state.weighted_sum / (double)stats->pixel_count;
+    if (leaves) *leaves = state.leaves;
+    return 1;
+}
+
+typedef struct QTPointKey
+{
+    unsigned int morton;
+    unsigned int index;
+} QTPointKey;
+
+// Keys use the low 16 bits of each coordinate; larger images only lose some locality.
+static unsigned int spread_bits(unsigned int value)
+{
+    unsigned int x = value & 0xFFFF;
+    x = (x | (x << 8)) & 0x00FF00FF;
+    x = (x | (x << 4)) & 0x0F0F0F0F;
+    x = (x | (x << 2)) & 0x33333333;
+    x = (x | (x << 1)) & 0x55555555;
+    return x;
+}
+
+// LSD radix sort on the 32-bit Morton key, one byte per pass. The four passes leave
+// the sorted keys back in `keys`.
+static void sort_point_keys(QTPointKey *keys, QTPointKey *scratch, size_t count)
+{
+    for (int shift = 0; shift < 32; shift += 8)
+    {
+        size_t offsets[257] = {0};
+        for (size_t i = 0; i < count; i++) offsets[((keys[i].morton >> shift) & 0xFF) + 1]++;
+        for (int b = 0; b < 256; b++) offsets[b + 1] += offsets[b];
+        for (size_t i = 0; i < count; i++) scratch[offsets[(keys[i].morton >> shift) & 0xFF]++] = keys[i];
+        QTPointKey *swap = keys;
+        keys = scratch;
+        scratch = swap;
+    }
+}
+
+// Answers the points in Morton order and keeps the path of the previous lookup, so each
+// query only climbs to the lowest ancestor that contains it before descending again.
+// Results are written in the caller's original order.
+int query_qt_points(QTNode *root, const int *rows, const int *cols, size_t count, unsigned char *intensities)
+{
+    QTPointKey *keys = (QTPointKey *)malloc((count ? 2 * count : 1) * sizeof(QTPointKey));
+    if (!keys)
+    {
+        ERROR("Memory allocation failed for point query keys");
+        return 0;
+    }
+    for (size_t i = 0; i < count; i++)
+    {
+        keys[i].morton = spread_bits((unsigned int)rows[i]) << 1 | spread_bits((unsigned int)cols[i]);
+        keys[i].index = (unsigned int)i;
+    }
+    sort_point_keys(keys, keys + count, count);
+
+    QTNode *path[QT_QUERY_STACK_SIZE];
+    QTRegion regions[QT_QUERY_STACK_SIZE];
+    int depth = 0;
+    if (root)
+    {
+        path[0] = root;
+        regions[0] = (QTRegion){0, 0, root->width, root->height};
+        depth = 1;
+    }
+    for (size_t i = 0; i < count; i++)
+    {
+        int row = rows[keys[i].index];
+        int col = cols[keys[i].index];
+        if (depth == 0 || !region_contains(regions[0], row, col))
+        {
+            intensities[keys[i].index] = 0;
+            continue;
+        }
+        while (!region_contains(regions[depth - 1], row, col)) depth--;
+
+        while (depth < QT_QUERY_STACK_SIZE && !path[depth - 1]->is_leaf)
+        {
+            QTRegion children[4];
+            if (split_qt_region(regions[depth - 1], children) == 0) break;
+            int slot = child_slot(regions[depth - 1], row, col);
+            if (!path[depth - 1]->children[slot]) break;
+            path[depth] = path[depth - 1]->children[slot];
+            regions[depth] = children[slot];
+            depth++;
+        }
+        intensities[keys[i].index] = path[depth - 1]->intensity;
+    }
+    free(keys);
+    return 1;
+}
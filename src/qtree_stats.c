@@ -0,0 +1,219 @@
+#include <string.h>
+#include <time.h>
+#include "qtree_stats.h"
+
+// Times are kept in nanoseconds so every counter can use the same atomic add.
+static unsigned long long phase_nanoseconds[QT_STATS_PHASE_COUNT];
+static unsigned long long phase_calls[QT_STATS_PHASE_COUNT];
+static unsigned long long nodes_by_depth[QT_STATS_DEPTHS];
+static unsigned long long leaves_by_depth[QT_STATS_DEPTHS];
+static unsigned long long area_by_depth[QT_STATS_DEPTHS];
+static unsigned long long area_by_level[QT_STATS_LEVELS];
+static unsigned long long scanned_by_level[QT_STATS_LEVELS];
+static unsigned long long bytes_read;
+static unsigned long long bytes_written;
+
+static void add_counter(unsigned long long *counter, unsigned long long amount)
+{
+    if (amount) __atomic_fetch_add(counter, amount, __ATOMIC_RELAXED);
+}
+
+static unsigned long long load_counter(unsigned long long *counter)
+{
+    return __atomic_load_n(counter, __ATOMIC_RELAXED);
+}
+
+int qt_stats_enabled(void)
+{
+#ifdef QTREE_STATS
+    return 1;
+#else
+    return 0;
+#endif
+}
+
+void reset_qt_stats(void)
+{
+    for (int i = 0; i < QT_STATS_PHASE_COUNT; i++)
+    {
+        __atomic_store_n(&phase_nanoseconds[i], 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&phase_calls[i], 0, __ATOMIC_RELAXED);
+    }
+    for (int i = 0; i < QT_STATS_DEPTHS; i++)
+    {
+        __atomic_store_n(&nodes_by_depth[i], 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&leaves_by_depth[i], 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&area_by_depth[i], 0, __ATOMIC_RELAXED);
+    }
+    for (int i = 0; i < QT_STATS_LEVELS; i++)
+    {
+        __atomic_store_n(&area_by_level[i], 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&scanned_by_level[i], 0, __ATOMIC_RELAXED);
+    }
+    __atomic_store_n(&bytes_read, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&bytes_written, 0, __ATOMIC_RELAXED);
+}
+
+void get_qt_stats(QTStats *stats)
+{
+    for (int i = 0; i < QT_STATS_PHASE_COUNT; i++)
+    {
+        stats->phase_seconds[i] = (double)load_counter(&phase_nanoseconds[i]) * 1e-9;
+        stats->phase_calls[i] = load_counter(&phase_calls[i]);
+    }
+    for (int i = 0; i < QT_STATS_DEPTHS; i++)
+    {
+        stats->nodes_by_depth[i] = load_counter(&nodes_by_depth[i]);
+        stats->leaves_by_depth[i] = load_counter(&leaves_by_depth[i]);
+        stats->area_by_depth[i] = load_counter(&area_by_depth[i]);
+    }
+    for (int i = 0; i < QT_STATS_LEVELS; i++)
+    {
+        stats->area_by_level[i] = load_counter(&area_by_level[i]);
+        stats->scanned_by_level[i] = load_counter(&scanned_by_level[i]);
+    }
+    stats->bytes_read = load_counter(&bytes_read);
+    stats->bytes_written = load_counter(&bytes_written);
+}
+
+const char *qt_stats_phase_name(QTStatsPhase phase)
+{
+    switch (phase)
+    {
+        case QT_STATS_PARSE: return "parse";
+        case QT_STATS_BUILD: return "build";
+        case QT_STATS_SERIALIZE: return "serialize";
+        case QT_STATS_RENDER: return "render";
+        default: return "unknown";
+    }
+}
+
+static void write_depth_array(FILE *file, const char *key, unsigned long long *values, int depth_count)
+{
+    fprintf(file, "  \"%s\": [", key);
+    for (int i = 0; i < depth_count; i++) fprintf(file, "%s%llu", i ? ", " : "", values[i]);
+    fprintf(file, "]");
+}
+
+void write_qt_stats_json(QTStats *stats, FILE *file)
+{
+    int depth_count = QT_STATS_DEPTHS;
+    while (depth_count > 0 && stats->nodes_by_depth[depth_count - 1] == 0) depth_count--;
+    int level_count = QT_STATS_LEVELS;
+    while (level_count > 0 && stats->area_by_level[level_count - 1] == 0 && stats->scanned_by_level[level_count - 1] == 0) level_count--;
+    unsigned long long nodes = 0, leaves = 0, area = 0, scanned = 0;
+    for (int i = 0; i < depth_count; i++)
+    {
+        nodes += stats->nodes_by_depth[i];
+        leaves += stats->leaves_by_depth[i];
+    }
+    for (int i = 0; i < level_count; i++)
+    {
+        area += stats->area_by_level[i];
+        scanned += stats->scanned_by_level[i];
+    }
+
+    fprintf(file, "{\n  \"enabled\": %s,\n  \"phases\": {", qt_stats_enabled() ? "true" : "false");
+    for (int i = 0; i < QT_STATS_PHASE_COUNT; i++)
+    {
+        fprintf(file, "%s\n    \"%s\": {\"calls\": %llu, \"seconds\": %.9f}", i ? "," : "", qt_stats_phase_name((QTStatsPhase)i),
+                stats->phase_calls[i], stats->phase_seconds[i]);
+    }
+    fprintf(file, "\n  },\n  \"bytes_read\": %llu,\n  \"bytes_written\": %llu,\n", stats->bytes_read, stats->bytes_written);
+    fprintf(file, "  \"nodes\": %llu,\n  \"leaves\": %llu,\n  \"internal\": %llu,\n  \"leaf_ratio\": %.6f,\n", nodes, leaves, nodes - leaves,
+            nodes ? (double)leaves / (double)nodes : 0.0);
+    write_depth_array(file, "nodes_by_depth", stats->nodes_by_depth, depth_count);
+    fprintf(file, ",\n");
+    write_depth_array(file, "leaves_by_depth", stats->leaves_by_depth, depth_count);
+    fprintf(file, ",\n");
+    write_depth_array(file, "area_by_depth", stats->area_by_depth, depth_count);
+    fprintf(file, ",\n  \"area\": %llu,\n  \"scanned\": %llu,\n", area, scanned);
+    write_depth_array(file, "area_by_level", stats->area_by_level, level_count);
+    fprintf(file, ",\n");
+    write_depth_array(file, "scanned_by_level", stats->scanned_by_level, level_count);
+    fprintf(file, "\n}\n");
+}
+
+int save_qt_stats_json(QTStats *stats, char *filename)
+{
+    FILE *file = fopen(filename, "w");
+    if (!file)
+    {
+        ERROR("Failed to open file %s for writing", filename);
+        return 0;
+    }
+    write_qt_stats_json(stats, file);
+    return fclose(file) == 0;
+}
+
+double qt_stats_clock(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+void record_qt_phase(QTStatsPhase phase, double seconds)
+{
+    add_counter(&phase_nanoseconds[phase], seconds > 0 ? (unsigned long long)(seconds * 1e9) : 0);
+    add_counter(&phase_calls[phase], 1);
+}
+
+void record_qt_bytes(long long read_count, long long written_count)
+{
+    if (read_count > 0) add_counter(&bytes_read, (unsigned long long)read_count);
+    if (written_count > 0) add_counter(&bytes_written, (unsigned long long)written_count);
+}
+
+static int region_level(int width, int height)
+{
+    unsigned int side = (unsigned int)(width > height ? width : height);
+    int level = side > 1 ? 32 - __builtin_clz(side - 1) : 0;
+    return level < QT_STATS_LEVELS ? level : QT_STATS_LEVELS - 1;
+}
+
+typedef struct TreeTally
+{
+    unsigned long long nodes[QT_STATS_DEPTHS];
+    unsigned long long leaves[QT_STATS_DEPTHS];
+    unsigned long long area[QT_STATS_DEPTHS];
+    unsigned long long level_area[QT_STATS_LEVELS];
+} TreeTally;
+
+static void count_tree_depths(QTNode *node, int depth, TreeTally *tally)
+{
+    if (!node) return;
+    int bucket = depth < QT_STATS_DEPTHS ? depth : QT_STATS_DEPTHS - 1;
+    unsigned long long area = (unsigned long long)node->width * (unsigned long long)node->height;
+    tally->nodes[bucket]++;
+    tally->area[bucket] += area;
+    tally->level_area[region_level(node->width, node->height)] += area;
+    if (node->is_leaf)
+    {
+        tally->leaves[bucket]++;
+        return;
+    }
+    for (int i = 0; i < 4; i++) count_tree_depths(node->children[i], depth + 1, tally);
+}
+
+// Tallies a finished tree locally and publishes one atomic add per depth and level.
+void record_qt_tree(QTNode *root)
+{
+    TreeTally tally;
+    memset(&tally, 0, sizeof(tally));
+    count_tree_depths(root, 0, &tally);
+    for (int i = 0; i < QT_STATS_DEPTHS; i++)
+    {
+        add_counter(&nodes_by_depth[i], tally.nodes[i]);
+        add_counter(&leaves_by_depth[i], tally.leaves[i]);
+        add_counter(&area_by_depth[i], tally.area[i]);
+    }
+    for (int i = 0; i < QT_STATS_LEVELS; i++) add_counter(&area_by_level[i], tally.level_area[i]);
+}
+
+// Counts the pixels a scan of a width x height region actually read, which is fewer than
+// its area when the scan stopped early.
+void record_qt_scan(int width, int height, unsigned long long pixels)
+{
+    add_counter(&scanned_by_level[region_level(width, height)], pixels);
+}
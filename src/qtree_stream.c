@@ -0,0 +1,199 @@
+#include "qtree_stream.h"
+#include "qtree_binary.h"
+#include "region_sums.h"
+#include <stdlib.h>
+
+// One node of the tree above the tiles. Row split positions depend only on a region's
+// height, so every tile in a band has the same row range and bands never overlap.
+typedef struct QTStreamNode
+{
+    QTRegion region;
+    int children[4];
+    int is_tile;
+    unsigned long long sum;
+    unsigned long long sum_sq;
+    long long spill_offset;
+} QTStreamNode;
+
+typedef struct QTStreamBuild
+{
+    QTStreamNode *nodes;
+    int count;
+    int capacity;
+    unsigned int band_rows;
+    double max_rmse;
+    FILE *spill;
+} QTStreamBuild;
+
+static int add_stream_node(QTStreamBuild *build, QTRegion region)
+{
+    if (build->count == build->capacity)
+    {
+        int capacity = build->capacity ? 2 * build->capacity : 256;
+        QTStreamNode *grown = (QTStreamNode *)realloc(build->nodes, (size_t)capacity * sizeof(QTStreamNode));
+        if (!grown)
+        {
+            ERROR("Memory allocation failed for streaming quadtree nodes");
+            return -1;
+        }
+        build->nodes = grown;
+        build->capacity = capacity;
+    }
+    int index = build->count++;
+    QTStreamNode *node = &build->nodes[index];
+    node->region = region;
+    for (int i = 0; i < 4; i++) node->children[i] = -1;
+    node->sum = 0;
+    node->sum_sq = 0;
+    node->spill_offset = -1;
+
+    QTRegion children[4];
+    node->is_tile = (unsigned int)region.height <= build->band_rows || split_qt_region(region, children) == 0;
+    if (node->is_tile) return index;
+    for (int i = 0; i < 4; i++)
+    {
+        if (children[i].width == 0) continue;
+        int child = add_stream_node(build, children[i]);
+        if (child < 0) return -1;
+        build->nodes[index].children[i] = child;
+    }
+    return index;
+}
+
+typedef struct QTStreamTileOrder
+{
+    int row;
+    int col;
+    int index;
+} QTStreamTileOrder;
+
+static int compare_tile_order(const void *a, const void *b)
+{
+    const QTStreamTileOrder *tile_a = (const QTStreamTileOrder *)a;
+    const QTStreamTileOrder *tile_b = (const QTStreamTileOrder *)b;
+    if (tile_a->row != tile_b->row) return tile_a->row < tile_b->row ? -1 : 1;
+    return tile_a->col < tile_b->col ? -1 : tile_a->col > tile_b->col;
+}
+
+// Builds one tile from the band in memory, records its exact sums and appends its
+// binary node stream to the spill file.
+static int build_stream_tile(QTStreamBuild *build, QTStreamNode *tile, Image *band)
+{
+    QTRegion local = {0, tile->region.col, tile->region.width, tile->region.height};
+    get_image_region_sums(band, local.col, 0, local.width, local.height, &tile->sum, &tile->sum_sq);
+    QTNode *subtree = create_quadtree_region(band, local, build->max_rmse);
+    if (!subtree) return 0;
+
+    tile->spill_offset = ftell(build->spill);
+    QTBinaryWriter *writer = attach_binary_qt_writer(build->spill);
+    int ok = tile->spill_offset >= 0 && writer && write_binary_qt_subtree(writer, subtree, local);
+    if (!detach_binary_qt_writer(writer)) ok = 0;
+    delete_quadtree(subtree);
+    return ok;
+}
+
+static int build_stream_bands(QTStreamBuild *build, ImageReader *reader)
+{
+    int tile_count = 0;
+    for (int i = 0; i < build->count; i++) tile_count += build->nodes[i].is_tile;
+    QTStreamTileOrder *order = (QTStreamTileOrder *)malloc((size_t)tile_count * sizeof(QTStreamTileOrder));
+    Image *band = create_image(reader->width, build->band_rows < reader->height ? build->band_rows : reader->height, 1);
+    if (!order || !band)
+    {
+        ERROR("Memory allocation failed for streaming quadtree band");
+        free(order);
+        delete_image(band);
+        return 0;
+    }
+    int next = 0;
+    for (int i = 0; i < build->count; i++)
+    {
+        if (build->nodes[i].is_tile) order[next++] = (QTStreamTileOrder){build->nodes[i].region.row, build->nodes[i].region.col, i};
+    }
+    qsort(order, (size_t)tile_count, sizeof(QTStreamTileOrder), compare_tile_order);
+
+    int ok = 1;
+    for (int first = 0; ok && first < tile_count;)
+    {
+        QTStreamNode *head = &build->nodes[order[first].index];
+        band->height = (unsigned int)head->region.height;
+        ok = read_image_rows(reader, band->data, band->height);
+        int last = first;
+        while (ok && last < tile_count && order[last].row == order[first].row)
+        {
+            ok = build_stream_tile(build, &build->nodes[order[last].index], band);
+            last++;
+        }
+        first = last;
+    }
+    free(order);
+    delete_image(band);
+    return ok;
+}
+
+static int emit_stream_node(QTStreamBuild *build, int index, QTBinaryWriter *out)
+{
+    QTStreamNode *node = &build->nodes[index];
+    if (node->is_tile)
+    {
+        if (fseek(build->spill, node->spill_offset, SEEK_SET) != 0) return 0;
+        QTBinaryReader *reader = attach_binary_qt_reader(build->spill, node->region.width, node->region.height);
+        if (!reader) return 0;
+        QTNode *subtree = read_binary_qt_subtree(reader, node->region);
+        detach_binary_qt_reader(reader);
+        int ok = subtree && write_binary_qt_subtree(out, subtree, node->region);
+        delete_quadtree(subtree);
+        return ok;
+    }
+
+    unsigned char intensity;
+    int is_leaf = evaluate_qt_region_sums(node->region, node->sum, node->sum_sq, build->max_rmse, &intensity);
+    if (!write_binary_qt_node(out, is_leaf, intensity)) return 0;
+    if (is_leaf) return 1;
+    for (int i = 0; i < 4; i++)
+    {
+        if (node->children[i] >= 0 && !emit_stream_node(build, node->children[i], out)) return 0;
+    }
+    return 1;
+}
+
+int create_quadtree_streaming(char *image_filename, char *output_filename, double max_rmse, unsigned int band_rows, char *spill_filename)
+{
+    ImageReader *reader = open_image_reader(image_filename);
+    if (!reader)
+    {
+        ERROR("Failed to open image %s", image_filename);
+        return 0;
+    }
+
+    QTStreamBuild build = {NULL, 0, 0, band_rows ? band_rows : QT_STREAM_DEFAULT_BAND_ROWS, max_rmse, NULL};
+    build.spill = spill_filename ? fopen(spill_filename, "w+b") : tmpfile();
+    QTRegion root = {0, 0, (int)reader->width, (int)reader->height};
+    int ok = build.spill && add_stream_node(&build, root) == 0 && build_stream_bands(&build, reader);
+    close_image_reader(reader);
+
+    // Children follow their parent in preorder, so a reverse sweep totals every subtree.
+    for (int i = build.count - 1; ok && i >= 0; i--)
+    {
+        QTStreamNode *node = &build.nodes[i];
+        for (int c = 0; c < 4 && !node->is_tile; c++)
+        {
+            if (node->children[c] < 0) continue;
+            node->sum += build.nodes[node->children[c]].sum;
+            node->sum_sq += build.nodes[node->children[c]].sum_sq;
+        }
+    }
+
+    if (ok)
+    {
+        QTBinaryWriter *out = open_binary_qt_writer(output_filename, root.width, root.height);
+        ok = out && emit_stream_node(&build, 0, out);
+        if (!close_binary_qt_writer(out)) ok = 0;
+    }
+
+    if (build.spill) fclose(build.spill);
+    if (spill_filename) remove(spill_filename);
+    free(build.nodes);
+    if (!ok) ERROR("Streaming quadtree build of %s failed", image_filename);
+    return ok;
+}
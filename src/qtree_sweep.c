@@ -0,0 +1,266 @@
+#include "qtree_sweep.h"
+#include "region_sums.h"
+#include <math.h>
+#include <stdlib.h>
+
+#define QT_SWEEP_BLOCK_SIZE 16
+
+typedef struct QTErrorBuild
+{
+    Image *image;
+    QTErrorNode *nodes;
+    unsigned int count;
+    unsigned int capacity;
+    double min_rmse;
+} QTErrorBuild;
+
+static int grow_error_nodes(QTErrorBuild *build)
+{
+    if (build->count < build->capacity) return 1;
+    unsigned int capacity = build->capacity ? 2 * build->capacity : 1024;
+    QTErrorNode *grown = (QTErrorNode *)realloc(build->nodes, (size_t)capacity * sizeof(QTErrorNode));
+    if (!grown)
+    {
+        ERROR("Memory allocation failed for error hierarchy nodes");
+        return 0;
+    }
+    build->nodes = grown;
+    build->capacity = capacity;
+    return 1;
+}
+
+// create_quadtree_recursive at min_rmse, appending nodes in preorder with their errors.
+// Above QT_SWEEP_BLOCK_SIZE the children are built first and their sums totaled, and a
+// region that turns out to be a leaf drops the nodes appended below it; smaller regions
+// sum their own pixels and split top-down, re-reading at most a cached block. So the
+// build makes one pass over the image rather than one per level.
+static int add_error_node(QTErrorBuild *build, QTRegion region, unsigned long long *sum, unsigned long long *sum_sq)
+{
+    if (!grow_error_nodes(build)) return 0;
+    unsigned int index = build->count++;
+    QTRegion children[4];
+    split_qt_region(region, children);
+    int block = region.width <= QT_SWEEP_BLOCK_SIZE && region.height <= QT_SWEEP_BLOCK_SIZE;
+    unsigned long long child_sum, child_sum_sq;
+    *sum = *sum_sq = 0;
+    if (block)
+    {
+        get_image_region_sums(build->image, region.col, region.row, region.width, region.height, sum, sum_sq);
+    }
+    else
+    {
+        for (int i = 0; i < 4; i++)
+        {
+            if (children[i].width == 0) continue;
+            if (!add_error_node(build, children[i], &child_sum, &child_sum_sq)) return 0;
+            *sum += child_sum;
+            *sum_sq += child_sum_sq;
+        }
+    }
+
+    QTErrorNode *node = &build->nodes[index];
+    node->rmse = calculate_qt_region_rmse(region, *sum, *sum_sq, &node->intensity);
+    unsigned long long pixel_count = (unsigned long long)region.width * region.height;
+    unsigned long long mean = node->intensity;
+    node->squared_error = *sum_sq + mean * mean * pixel_count - 2 * mean * *sum;
+    node->is_leaf = node->rmse <= build->min_rmse || (region.width <= 1 && region.height <= 1);
+    if (node->is_leaf) build->count = index + 1;
+    else if (block)
+    {
+        for (int i = 0; i < 4; i++)
+        {
+            if (children[i].width > 0 && !add_error_node(build, children[i], &child_sum, &child_sum_sq)) return 0;
+        }
+    }
+    build->nodes[index].end = build->count;
+    return 1;
+}
+
+QTErrorHierarchy *create_qt_error_hierarchy(Image *image, double min_rmse)
+{
+    if (!image) return NULL;
+    QTErrorHierarchy *hierarchy = (QTErrorHierarchy *)malloc(sizeof(QTErrorHierarchy));
+    if (!hierarchy)
+    {
+        ERROR("Memory allocation failed for QTErrorHierarchy");
+        return NULL;
+    }
+
+    QTErrorBuild build = {image, NULL, 0, 0, min_rmse};
+    QTRegion root = {0, 0, (int)image->width, (int)image->height};
+    unsigned long long sum, sum_sq;
+    if (!add_error_node(&build, root, &sum, &sum_sq))
+    {
+        free(build.nodes);
+        free(hierarchy);
+        return NULL;
+    }
+
+    hierarchy->width = root.width;
+    hierarchy->height = root.height;
+    hierarchy->min_rmse = min_rmse;
+    hierarchy->node_count = build.count;
+    hierarchy->nodes = build.nodes;
+    return hierarchy;
+}
+
+void delete_qt_error_hierarchy(QTErrorHierarchy *hierarchy)
+{
+    if (hierarchy)
+    {
+        free(hierarchy->nodes);
+        free(hierarchy);
+    }
+}
+
+static int check_threshold(QTErrorHierarchy *hierarchy, double max_rmse)
+{
+    if (!hierarchy) return 0;
+    if (max_rmse < hierarchy->min_rmse)
+    {
+        ERROR("max_rmse %g is below the hierarchy's min_rmse %g", max_rmse, hierarchy->min_rmse);
+        return 0;
+    }
+    return 1;
+}
+
+static int is_leaf_at(QTErrorNode *node, double max_rmse)
+{
+    return node->is_leaf || node->rmse <= max_rmse;
+}
+
+// Walks the pruned tree in array order: a node that becomes a leaf skips its subtree.
+static void measure_pruned_tree(QTErrorHierarchy *hierarchy, double max_rmse, QTRatePoint *point)
+{
+    unsigned long long squared_error = 0;
+    point->max_rmse = max_rmse;
+    point->node_count = 0;
+    point->leaf_count = 0;
+    for (unsigned int i = 0; i < hierarchy->node_count;)
+    {
+        QTErrorNode *node = &hierarchy->nodes[i];
+        point->node_count++;
+        if (is_leaf_at(node, max_rmse))
+        {
+            point->leaf_count++;
+            squared_error += node->squared_error;
+            i = node->end;
+        }
+        else
+        {
+            i++;
+        }
+    }
+    point->mse = (double)squared_error / ((double)hierarchy->width * hierarchy->height);
+    point->psnr = point->mse > 0 ? 10 * log10(255.0 * 255.0 / point->mse) : (double)INFINITY;
+}
+
+unsigned int count_qt_nodes_at(QTErrorHierarchy *hierarchy, double max_rmse)
+{
+    if (!check_threshold(hierarchy, max_rmse)) return 0;
+    QTRatePoint point;
+    measure_pruned_tree(hierarchy, max_rmse, &point);
+    return point.node_count;
+}
+
+static void fill_pruned_nodes(QTErrorHierarchy *hierarchy, unsigned int index, double max_rmse, LinearQTNode *nodes, unsigned int *next)
+{
+    QTErrorNode *node = &hierarchy->nodes[index];
+    unsigned int out = (*next)++;
+    nodes[out].intensity = node->intensity;
+    nodes[out].is_leaf = is_leaf_at(node, max_rmse);
+    if (!nodes[out].is_leaf)
+    {
+        for (unsigned int child = index + 1; child < node->end; child = hierarchy->nodes[child].end)
+        {
+            fill_pruned_nodes(hierarchy, child, max_rmse, nodes, next);
+        }
+    }
+    nodes[out].end = *next;
+}
+
+LinearQTree *extract_linear_qtree_at(QTErrorHierarchy *hierarchy, double max_rmse)
+{
+    unsigned int node_count = count_qt_nodes_at(hierarchy, max_rmse);
+    if (node_count == 0) return NULL;
+
+    LinearQTree *tree = (LinearQTree *)malloc(sizeof(LinearQTree));
+    if (!tree)
+    {
+        ERROR("Memory allocation failed for LinearQTree");
+        return NULL;
+    }
+    tree->width = hierarchy->width;
+    tree->height = hierarchy->height;
+    tree->node_count = node_count;
+    tree->nodes = (LinearQTNode *)malloc((size_t)node_count * sizeof(LinearQTNode));
+    if (!tree->nodes)
+    {
+        ERROR("Memory allocation failed for LinearQTree nodes");
+        free(tree);
+        return NULL;
+    }
+    unsigned int next = 0;
+    fill_pruned_nodes(hierarchy, 0, max_rmse, tree->nodes, &next);
+    return tree;
+}
+
+static QTNode *extract_pruned_node(QTErrorHierarchy *hierarchy, unsigned int index, QTRegion region, double max_rmse)
+{
+    QTNode *node = (QTNode *)malloc(sizeof(QTNode));
+    if (!node)
+    {
+        ERROR("Memory allocation failed for QTNode");
+        return NULL;
+    }
+    QTErrorNode *error = &hierarchy->nodes[index];
+    node->intensity = error->intensity;
+    node->is_leaf = is_leaf_at(error, max_rmse);
+    node->width = region.width;
+    node->height = region.height;
+    for (int i = 0; i < 4; i++) node->children[i] = NULL;
+    if (node->is_leaf) return node;
+
+    QTRegion children[4];
+    split_qt_region(region, children);
+    unsigned int child = index + 1;
+    for (int i = 0; i < 4; i++)
+    {
+        if (children[i].width == 0) continue;
+        node->children[i] = extract_pruned_node(hierarchy, child, children[i], max_rmse);
+        if (!node->children[i])
+        {
+            delete_quadtree(node);
+            return NULL;
+        }
+        child = hierarchy->nodes[child].end;
+    }
+    return node;
+}
+
+QTNode *extract_quadtree_at(QTErrorHierarchy *hierarchy, double max_rmse)
+{
+    if (!check_threshold(hierarchy, max_rmse)) return NULL;
+    QTRegion root = {0, 0, hierarchy->width, hierarchy->height};
+    return extract_pruned_node(hierarchy, 0, root, max_rmse);
+}
+
+unsigned char *render_qt_hierarchy_at(QTErrorHierarchy *hierarchy, double max_rmse)
+{
+    LinearQTree *tree = extract_linear_qtree_at(hierarchy, max_rmse);
+    unsigned char *pixels = render_linear_qtree(tree);
+    delete_linear_qtree(tree);
+    return pixels;
+}
+
+// Fills points[i] for thresholds[i]. Distortion comes from the recorded leaf errors, so
+// the curve needs neither the image nor any extracted tree.
+int get_qt_rate_distortion(QTErrorHierarchy *hierarchy, double *thresholds, int count, QTRatePoint *points)
+{
+    for (int i = 0; i < count; i++)
+    {
+        if (!check_threshold(hierarchy, thresholds[i])) return 0;
+        measure_pruned_tree(hierarchy, thresholds[i], &points[i]);
+    }
+    return 1;
+}
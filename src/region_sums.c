@@ -0,0 +1,242 @@
+#include "region_sums.h"
+#include "qtree_stats.h"
+#include <pthread.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define REGION_SUMS_X86 1
+#else
+#define REGION_SUMS_X86 0
+#endif
+
+#define REGION_SUMS_MAX_SPAN 65536
+
+typedef void (*RowSumsFunction)(const unsigned char *row, int width, unsigned long long *sum, unsigned long long *sum_sq);
+
+// The helpers below are always inlined, so each kernel runs them in its own instruction
+// set; calling legacy-SSE code from an AVX2 function with dirty upper registers costs far
+// more than the work itself.
+static inline __attribute__((always_inline)) void scalar_span_sums(const unsigned char *row, int width, unsigned long long *sum, unsigned long long *sum_sq)
+{
+    unsigned int row_sum = 0;
+    unsigned long long row_sum_sq = 0;
+    for (int i = 0; i < width; i++)
+    {
+        row_sum += row[i];
+        row_sum_sq += (unsigned int)row[i] * row[i];
+    }
+    *sum += row_sum;
+    *sum_sq += row_sum_sq;
+}
+
+static void row_sums_scalar(const unsigned char *row, int width, unsigned long long *sum, unsigned long long *sum_sq)
+{
+    scalar_span_sums(row, width, sum, sum_sq);
+}
+
+#if REGION_SUMS_X86
+// Squares are accumulated in 32-bit lanes for one span at a time. Spans are at most
+// REGION_SUMS_MAX_SPAN pixels, so no lane exceeds 4 * 65536 * 255^2 / 16 < 2^31.
+static inline __attribute__((always_inline)) int sse2_span_sums(const unsigned char *row, int width, unsigned long long *sum, unsigned long long *sum_sq)
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i sums = zero;
+    __m128i squares = zero;
+    int i = 0;
+    for (; i + 16 <= width; i += 16)
+    {
+        __m128i pixels = _mm_loadu_si128((const __m128i *)(row + i));
+        sums = _mm_add_epi64(sums, _mm_sad_epu8(pixels, zero));
+        __m128i low = _mm_unpacklo_epi8(pixels, zero);
+        __m128i high = _mm_unpackhi_epi8(pixels, zero);
+        squares = _mm_add_epi32(squares, _mm_madd_epi16(low, low));
+        squares = _mm_add_epi32(squares, _mm_madd_epi16(high, high));
+    }
+    unsigned long long lanes[2];
+    unsigned int square_lanes[4];
+    _mm_storeu_si128((__m128i *)lanes, sums);
+    _mm_storeu_si128((__m128i *)square_lanes, squares);
+    *sum += lanes[0] + lanes[1];
+    *sum_sq += (unsigned long long)square_lanes[0] + square_lanes[1] + square_lanes[2] + square_lanes[3];
+    return i;
+}
+
+__attribute__((target("sse2")))
+static void row_sums_sse2(const unsigned char *row, int width, unsigned long long *sum, unsigned long long *sum_sq)
+{
+    int done = width >= 16 ? sse2_span_sums(row, width, sum, sum_sq) : 0;
+    scalar_span_sums(row + done, width - done, sum, sum_sq);
+}
+
+__attribute__((target("avx2")))
+static void row_sums_avx2(const unsigned char *row, int width, unsigned long long *sum, unsigned long long *sum_sq)
+{
+    int i = 0;
+    if (width >= 32)
+    {
+        const __m256i zero = _mm256_setzero_si256();
+        __m256i sums = zero;
+        __m256i squares = zero;
+        for (; i + 32 <= width; i += 32)
+        {
+            __m256i pixels = _mm256_loadu_si256((const __m256i *)(row + i));
+            sums = _mm256_add_epi64(sums, _mm256_sad_epu8(pixels, zero));
+            __m256i low = _mm256_cvtepu8_epi16(_mm256_castsi256_si128(pixels));
+            __m256i high = _mm256_cvtepu8_epi16(_mm256_extracti128_si256(pixels, 1));
+            squares = _mm256_add_epi32(squares, _mm256_madd_epi16(low, low));
+            squares = _mm256_add_epi32(squares, _mm256_madd_epi16(high, high));
+        }
+        unsigned long long lanes[4];
+        unsigned int square_lanes[8];
+        _mm256_storeu_si256((__m256i *)lanes, sums);
+        _mm256_storeu_si256((__m256i *)square_lanes, squares);
+        *sum += lanes[0] + lanes[1] + lanes[2] + lanes[3];
+        unsigned long long square_total = 0;
+        for (int lane = 0; lane < 8; lane++) square_total += square_lanes[lane];
+        *sum_sq += square_total;
+    }
+    if (width - i >= 16) i += sse2_span_sums(row + i, width - i, sum, sum_sq);
+    scalar_span_sums(row + i, width - i, sum, sum_sq);
+}
+#endif
+
+static RowSumsFunction row_sums = row_sums_scalar;
+static RegionSumsKernel active_kernel = REGION_SUMS_SCALAR;
+static pthread_once_t auto_select_once = PTHREAD_ONCE_INIT;
+
+static int kernel_supported(RegionSumsKernel kernel)
+{
+#if REGION_SUMS_X86
+    __builtin_cpu_init();
+    if (kernel == REGION_SUMS_AVX2) return __builtin_cpu_supports("avx2");
+    if (kernel == REGION_SUMS_SSE2) return __builtin_cpu_supports("sse2");
+#endif
+    return kernel == REGION_SUMS_SCALAR;
+}
+
+static int apply_kernel(RegionSumsKernel kernel)
+{
+    if (kernel == REGION_SUMS_AUTO)
+    {
+        kernel = kernel_supported(REGION_SUMS_AVX2) ? REGION_SUMS_AVX2
+               : kernel_supported(REGION_SUMS_SSE2) ? REGION_SUMS_SSE2
+                                                    : REGION_SUMS_SCALAR;
+    }
+    if (!kernel_supported(kernel)) return 0;
+
+#if REGION_SUMS_X86
+    row_sums = kernel == REGION_SUMS_AVX2 ? row_sums_avx2 : kernel == REGION_SUMS_SSE2 ? row_sums_sse2 : row_sums_scalar;
+#endif
+    active_kernel = kernel;
+    return 1;
+}
+
+static void auto_select_kernel(void)
+{
+    apply_kernel(REGION_SUMS_AUTO);
+}
+
+// Returns 0 and leaves the current kernel in place when the CPU lacks the requested one.
+// Not synchronized with running scans; select before starting a build.
+int select_region_sums_kernel(RegionSumsKernel kernel)
+{
+    pthread_once(&auto_select_once, auto_select_kernel);
+    return apply_kernel(kernel);
+}
+
+const char *region_sums_kernel_name(void)
+{
+    pthread_once(&auto_select_once, auto_select_kernel);
+    switch (active_kernel)
+    {
+        case REGION_SUMS_AVX2: return "avx2";
+        case REGION_SUMS_SSE2: return "sse2";
+        default: return "scalar";
+    }
+}
+
+void get_image_region_sums(Image *image, int x, int y, int width, int height, unsigned long long *sum, unsigned long long *sum_sq)
+{
+    pthread_once(&auto_select_once, auto_select_kernel);
+    QT_STATS_SCAN(width, height, (unsigned long long)width * height);
+    *sum = 0;
+    *sum_sq = 0;
+    if (image->channels != 1)
+    {
+        for (int row = y; row < y + height; row++)
+        {
+            const unsigned char *src = image->data + ((size_t)row * image->width + x) * image->channels;
+            for (int col = 0; col < width; col++)
+            {
+                unsigned long long intensity = src[(size_t)col * image->channels];
+                *sum += intensity;
+                *sum_sq += intensity * intensity;
+            }
+        }
+        return;
+    }
+
+    add_strided_region_sums(image->data + (size_t)y * image->width + x, image->width, width, height, sum, sum_sq);
+}
+
+// Adds the sums of a width x height block of 8-bit samples whose rows start `stride`
+// bytes apart, for layouts other than an Image's plain rows.
+void add_strided_region_sums(const unsigned char *data, size_t stride, int width, int height, unsigned long long *sum, unsigned long long *sum_sq)
+{
+    pthread_once(&auto_select_once, auto_select_kernel);
+    RowSumsFunction kernel = row_sums;
+    for (int row = 0; row < height; row++)
+    {
+        const unsigned char *src = data + (size_t)row * stride;
+        for (int offset = 0; offset < width; offset += REGION_SUMS_MAX_SPAN)
+        {
+            kernel(src + offset, width - offset < REGION_SUMS_MAX_SPAN ? width - offset : REGION_SUMS_MAX_SPAN, sum, sum_sq);
+        }
+    }
+}
+
+// Whether rows holding `count` pixels with these sums already have at least split_error
+// squared error around their own mean, i.e. count * sum_sq - sum^2 >= split_error * count.
+// No intensity fits part of a region better than that part's mean, so the whole region's
+// squared error around any intensity is then at least split_error too. Products that
+// would overflow are treated as not proving anything.
+static int exceeds_split_error(unsigned long long count, unsigned long long sum, unsigned long long sum_sq, unsigned long long split_error)
+{
+    unsigned long long scaled_sum_sq, scaled_bound;
+    if (__builtin_mul_overflow(count, sum_sq, &scaled_sum_sq) || __builtin_mul_overflow(split_error, count, &scaled_bound)) return 0;
+    return scaled_sum_sq - sum * sum >= scaled_bound;
+}
+
+// Like get_image_region_sums, but gives up as soon as the rows scanned so far prove the
+// region's squared error is at least split_error, returning 0 with partial sums. Returns 1
+// with the full sums otherwise. Only grayscale images stop early.
+int get_image_region_sums_bounded(Image *image, int x, int y, int width, int height, unsigned long long split_error, unsigned long long *sum, unsigned long long *sum_sq)
+{
+    if (image->channels != 1)
+    {
+        get_image_region_sums(image, x, y, width, height, sum, sum_sq);
+        return 1;
+    }
+
+    pthread_once(&auto_select_once, auto_select_kernel);
+    *sum = 0;
+    *sum_sq = 0;
+    RowSumsFunction kernel = row_sums;
+    unsigned long long count = 0;
+    for (int row = y; row < y + height; row++)
+    {
+        const unsigned char *src = image->data + (size_t)row * image->width + x;
+        for (int offset = 0; offset < width; offset += REGION_SUMS_MAX_SPAN)
+        {
+            kernel(src + offset, width - offset < REGION_SUMS_MAX_SPAN ? width - offset : REGION_SUMS_MAX_SPAN, sum, sum_sq);
+        }
+        count += (unsigned long long)width;
+        if (exceeds_split_error(count, *sum, *sum_sq, split_error))
+        {
+            QT_STATS_SCAN(width, height, count);
+            return row + 1 == y + height;
+        }
+    }
+    QT_STATS_SCAN(width, height, count);
+    return 1;
+}
@@ -0,0 +1,435 @@
+#include "stego_packed.h"
+#include <fcntl.h>
+#include <pthread.h>
+#include <string.h>
+#include <unistd.h>
+
+// Payload kernels work on runs of consecutive carrier samples. Eight samples take exactly
+// bits_per_channel bytes of the stream, so aligned groups of 8 are moved as one 64-bit
+// word with one field per byte lane; unaligned heads and the stream's tail go one sample
+// at a time.
+#define STEGO_LSBS 0x0101010101010101ULL
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define STEGO_LANE_SHIFT(k) (8 * (k))
+#else
+#define STEGO_LANE_SHIFT(k) (56 - 8 * (k))
+#endif
+
+// One embed or extract over a carrier, split into STEGO_CHUNK_PIXELS chunks handed out to
+// workers in order. With fd >= 0 each worker also writes its chunk's output bytes.
+typedef struct StegoJob
+{
+    Image *carrier;
+    unsigned char *stream;
+    size_t stream_bytes;
+    StegoPacking packing;
+    int embed;
+    int fd;
+    off_t raster_offset;
+    size_t sample_count;
+    size_t payload_end;
+    size_t chunk_count;
+    size_t next_chunk;
+    int failed;
+    pthread_mutex_t lock;
+} StegoJob;
+
+static int valid_packing(StegoPacking packing)
+{
+    return packing.bits_per_channel >= 1 && packing.bits_per_channel <= 4 && (packing.channels == 1 || packing.channels == 3);
+}
+
+unsigned long long get_stego_capacity(unsigned int width, unsigned int height, StegoPacking packing)
+{
+    unsigned long long pixels = (unsigned long long)width * height;
+    if (!valid_packing(packing) || pixels <= STEGO_HEADER_PIXELS) return 0;
+    return (pixels - STEGO_HEADER_PIXELS) * packing.channels * packing.bits_per_channel / 8;
+}
+
+static unsigned int read_stream_field(const unsigned char *stream, size_t stream_bytes, size_t sample, int bits)
+{
+    size_t bit = sample * (size_t)bits;
+    size_t byte = bit / 8;
+    unsigned int window = (byte < stream_bytes ? (unsigned int)stream[byte] << 8 : 0) | (byte + 1 < stream_bytes ? stream[byte + 1] : 0);
+    return (window >> (16 - bits - bit % 8)) & ((1u << bits) - 1);
+}
+
+static void write_stream_field(unsigned char *stream, size_t stream_bytes, size_t sample, int bits, unsigned int field)
+{
+    size_t bit = sample * (size_t)bits;
+    size_t byte = bit / 8;
+    unsigned int window = field << (16 - bits - bit % 8);
+    if (byte < stream_bytes) stream[byte] |= (unsigned char)(window >> 8);
+    if (byte + 1 < stream_bytes) stream[byte + 1] |= (unsigned char)window;
+}
+
+// Writes stream samples [first, first + count) into the low bits of `samples`.
+static void embed_span(unsigned char *samples, size_t first, size_t count, const unsigned char *stream, size_t stream_bytes, int bits)
+{
+    unsigned char mask = (unsigned char)((1u << bits) - 1);
+    size_t sample = first, end = first + count;
+    for (; sample < end && sample % 8 != 0; sample++, samples++)
+    {
+        *samples = (unsigned char)((*samples & ~mask) | read_stream_field(stream, stream_bytes, sample, bits));
+    }
+    for (; end - sample >= 8 && (sample / 8 + 1) * bits <= stream_bytes; sample += 8, samples += 8)
+    {
+        const unsigned char *bytes = stream + sample / 8 * bits;
+        unsigned long long chunk = 0, fields = 0, word;
+        for (int i = 0; i < bits; i++) chunk = chunk << 8 | bytes[i];
+        for (int k = 0; k < 8; k++) fields |= ((chunk >> (bits * (7 - k))) & mask) << STEGO_LANE_SHIFT(k);
+        memcpy(&word, samples, sizeof(word));
+        word = (word & ~(STEGO_LSBS * mask)) | fields;
+        memcpy(samples, &word, sizeof(word));
+    }
+    for (; sample < end; sample++, samples++)
+    {
+        *samples = (unsigned char)((*samples & ~mask) | read_stream_field(stream, stream_bytes, sample, bits));
+    }
+}
+
+// Reads stream samples [first, first + count) from `samples`. Stream bytes must start at
+// zero; a span starting on a multiple of 8 samples never touches bytes before its own.
+static void extract_span(const unsigned char *samples, size_t first, size_t count, unsigned char *stream, size_t stream_bytes, int bits)
+{
+    unsigned char mask = (unsigned char)((1u << bits) - 1);
+    size_t sample = first, end = first + count;
+    for (; sample < end && sample % 8 != 0; sample++, samples++)
+    {
+        write_stream_field(stream, stream_bytes, sample, bits, *samples & mask);
+    }
+    for (; end - sample >= 8 && (sample / 8 + 1) * bits <= stream_bytes; sample += 8, samples += 8)
+    {
+        unsigned char *bytes = stream + sample / 8 * bits;
+        unsigned long long chunk = 0, word;
+        memcpy(&word, samples, sizeof(word));
+        for (int k = 0; k < 8; k++) chunk |= ((word >> STEGO_LANE_SHIFT(k)) & mask) << (bits * (7 - k));
+        for (int i = 0; i < bits; i++) bytes[i] = (unsigned char)(chunk >> (8 * (bits - 1 - i)));
+    }
+    for (; sample < end; sample++, samples++)
+    {
+        write_stream_field(stream, stream_bytes, sample, bits, *samples & mask);
+    }
+}
+
+// Runs the payload kernels row by row over the payload samples of carrier pixels
+// [first_pixel, last_pixel). RGB payloads are already contiguous in the carrier; red-only
+// payloads are gathered into `row` (carrier->width bytes) and scattered back.
+static void transfer_pixel_range(StegoJob *job, size_t first_pixel, size_t last_pixel, unsigned char *row)
+{
+    Image *carrier = job->carrier;
+    int bits = job->packing.bits_per_channel;
+    size_t channels = job->packing.channels;
+    size_t pixel = first_pixel > STEGO_HEADER_PIXELS ? first_pixel : STEGO_HEADER_PIXELS;
+    size_t last = last_pixel < job->payload_end ? last_pixel : job->payload_end;
+    while (pixel < last)
+    {
+        size_t row_end = (pixel / carrier->width + 1) * carrier->width;
+        size_t pixels = (row_end < last ? row_end : last) - pixel;
+        size_t first = (pixel - STEGO_HEADER_PIXELS) * channels;
+        size_t count = pixels * channels;
+        if (first + count > job->sample_count) count = job->sample_count - first;
+        unsigned char *samples = carrier->data + 3 * pixel;
+        if (channels == 3)
+        {
+            if (job->embed) embed_span(samples, first, count, job->stream, job->stream_bytes, bits);
+            else extract_span(samples, first, count, job->stream, job->stream_bytes, bits);
+        }
+        else
+        {
+            for (size_t i = 0; i < count; i++) row[i] = samples[3 * i];
+            if (job->embed)
+            {
+                embed_span(row, first, count, job->stream, job->stream_bytes, bits);
+                for (size_t i = 0; i < count; i++) samples[3 * i] = row[i];
+            }
+            else
+            {
+                extract_span(row, first, count, job->stream, job->stream_bytes, bits);
+            }
+        }
+        pixel += pixels;
+    }
+}
+
+static void init_stego_job(StegoJob *job, Image *carrier, Image *secret, StegoPacking packing, int embed)
+{
+    memset(job, 0, sizeof(StegoJob));
+    job->carrier = carrier;
+    job->stream = secret->data;
+    job->stream_bytes = (size_t)secret->width * secret->height;
+    job->packing = packing;
+    job->embed = embed;
+    job->fd = -1;
+}
+
+static int pwrite_fully(int fd, const unsigned char *data, size_t length, off_t offset)
+{
+    while (length > 0)
+    {
+        ssize_t written = pwrite(fd, data, length, offset);
+        if (written <= 0) return 0;
+        data += written;
+        length -= (size_t)written;
+        offset += written;
+    }
+    return 1;
+}
+
+// A chunk's bytes in the output file: its carrier pixels when embedding, or the stream
+// bytes its samples decode to when extracting.
+static int write_chunk(StegoJob *job, size_t first_pixel, size_t last_pixel)
+{
+    if (job->embed) return pwrite_fully(job->fd, job->carrier->data + 3 * first_pixel, 3 * (last_pixel - first_pixel), job->raster_offset + (off_t)(3 * first_pixel));
+
+    size_t first = first_pixel > STEGO_HEADER_PIXELS ? first_pixel : STEGO_HEADER_PIXELS;
+    size_t last = last_pixel < job->payload_end ? last_pixel : job->payload_end;
+    if (first >= last) return 1;
+    size_t bits = job->packing.bits_per_channel;
+    size_t first_byte = (first - STEGO_HEADER_PIXELS) * job->packing.channels * bits / 8;
+    size_t last_byte = last == job->payload_end ? job->stream_bytes : (last - STEGO_HEADER_PIXELS) * job->packing.channels * bits / 8;
+    return pwrite_fully(job->fd, job->stream + first_byte, last_byte - first_byte, job->raster_offset + (off_t)first_byte);
+}
+
+static void *stego_worker(void *arg)
+{
+    StegoJob *job = (StegoJob *)arg;
+    unsigned char *row = (unsigned char *)malloc(job->carrier->width);
+    int ok = row != NULL;
+    if (!ok) ERROR("Memory allocation failed for stego row buffer");
+
+    size_t pixel_count = (size_t)job->carrier->width * job->carrier->height;
+    while (ok)
+    {
+        pthread_mutex_lock(&job->lock);
+        size_t chunk = job->next_chunk;
+        if (!job->failed && chunk < job->chunk_count) job->next_chunk++;
+        int done = job->failed || chunk >= job->chunk_count;
+        pthread_mutex_unlock(&job->lock);
+        if (done) break;
+
+        size_t first_pixel = chunk * STEGO_CHUNK_PIXELS;
+        size_t last_pixel = first_pixel + STEGO_CHUNK_PIXELS < pixel_count ? first_pixel + STEGO_CHUNK_PIXELS : pixel_count;
+        transfer_pixel_range(job, first_pixel, last_pixel, row);
+        ok = job->fd < 0 || write_chunk(job, first_pixel, last_pixel);
+    }
+    if (!ok)
+    {
+        pthread_mutex_lock(&job->lock);
+        job->failed = 1;
+        pthread_mutex_unlock(&job->lock);
+    }
+    free(row);
+    return NULL;
+}
+
+// Chunks are a multiple of 8 pixels, as is the header, so every chunk's payload starts on
+// a multiple of 8 samples and chunks never share a stream byte: the result does not depend
+// on which thread ran which chunk. Only chunks holding payload are visited unless the
+// whole carrier is being written out.
+static int run_stego_job(StegoJob *job, int num_threads)
+{
+    int bits = job->packing.bits_per_channel;
+    job->sample_count = (job->stream_bytes * 8 + (size_t)bits - 1) / (size_t)bits;
+    job->payload_end = STEGO_HEADER_PIXELS + (job->sample_count + job->packing.channels - 1) / job->packing.channels;
+    size_t pixels = job->fd >= 0 && job->embed ? (size_t)job->carrier->width * job->carrier->height : job->payload_end;
+    job->chunk_count = (pixels + STEGO_CHUNK_PIXELS - 1) / STEGO_CHUNK_PIXELS;
+    job->next_chunk = 0;
+    job->failed = 0;
+    pthread_mutex_init(&job->lock, NULL);
+
+    pthread_t *threads = num_threads > 1 ? (pthread_t *)malloc((size_t)(num_threads - 1) * sizeof(pthread_t)) : NULL;
+    int started = 0;
+    while (threads && started < num_threads - 1 && pthread_create(&threads[started], NULL, stego_worker, job) == 0)
+    {
+        started++;
+    }
+    stego_worker(job);
+    for (int i = 0; i < started; i++) pthread_join(threads[i], NULL);
+    free(threads);
+    pthread_mutex_destroy(&job->lock);
+    return !job->failed;
+}
+
+static void write_header(Image *carrier, Image *secret, StegoPacking packing)
+{
+    unsigned char header[STEGO_HEADER_PIXELS / 8] = {STEGO_MAGIC, (unsigned char)(packing.bits_per_channel << 4 | packing.channels)};
+    for (int i = 0; i < 4; i++)
+    {
+        header[2 + i] = (unsigned char)(secret->width >> (24 - 8 * i));
+        header[6 + i] = (unsigned char)(secret->height >> (24 - 8 * i));
+    }
+    for (int i = 0; i < STEGO_HEADER_PIXELS; i++)
+    {
+        unsigned char *red = &carrier->data[3 * i];
+        *red = (unsigned char)((*red & ~1) | ((header[i / 8] >> (7 - i % 8)) & 1));
+    }
+}
+
+static int read_header(Image *carrier, unsigned int *width, unsigned int *height, StegoPacking *packing)
+{
+    if ((unsigned long long)carrier->width * carrier->height <= STEGO_HEADER_PIXELS) return 0;
+    unsigned char header[STEGO_HEADER_PIXELS / 8] = {0};
+    for (int i = 0; i < STEGO_HEADER_PIXELS; i++)
+    {
+        header[i / 8] = (unsigned char)(header[i / 8] << 1 | (carrier->data[3 * i] & 1));
+    }
+    packing->bits_per_channel = header[1] >> 4;
+    packing->channels = header[1] & 0xF;
+    *width = *height = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        *width = *width << 8 | header[2 + i];
+        *height = *height << 8 | header[6 + i];
+    }
+    return header[0] == STEGO_MAGIC && valid_packing(*packing) &&
+           (unsigned long long)*width * *height <= get_stego_capacity(carrier->width, carrier->height, *packing);
+}
+
+static int check_secret_fits(Image *carrier, Image *secret, StegoPacking packing)
+{
+    if (!carrier || !secret || carrier->channels != 3 || secret->channels != 1 || !valid_packing(packing)) return 0;
+    if ((unsigned long long)secret->width * secret->height > get_stego_capacity(carrier->width, carrier->height, packing))
+    {
+        ERROR("A %ux%u secret does not fit in a %ux%u carrier at %d bits x %d channels", secret->width, secret->height,
+              carrier->width, carrier->height, packing.bits_per_channel, packing.channels);
+        return 0;
+    }
+    return 1;
+}
+
+// The carrier must be RGB (load_image_rgb) and the secret grayscale (load_image).
+int embed_packed_image_parallel(Image *carrier, Image *secret, StegoPacking packing, int num_threads)
+{
+    if (!check_secret_fits(carrier, secret, packing)) return 0;
+    write_header(carrier, secret, packing);
+    StegoJob job;
+    init_stego_job(&job, carrier, secret, packing, 1);
+    return run_stego_job(&job, num_threads);
+}
+
+int embed_packed_image(Image *carrier, Image *secret, StegoPacking packing)
+{
+    return embed_packed_image_parallel(carrier, secret, packing, 1);
+}
+
+static Image *create_revealed_image(Image *carrier, StegoPacking *packing)
+{
+    unsigned int width, height;
+    if (!carrier || carrier->channels != 3 || !read_header(carrier, &width, &height, packing))
+    {
+        ERROR("Carrier has no packed image header");
+        return NULL;
+    }
+    Image *secret = create_image(width, height, 1);
+    if (secret) memset(secret->data, 0, (size_t)width * height);
+    return secret;
+}
+
+Image *extract_packed_image_parallel(Image *carrier, int num_threads)
+{
+    StegoPacking packing;
+    Image *secret = create_revealed_image(carrier, &packing);
+    if (!secret) return NULL;
+    StegoJob job;
+    init_stego_job(&job, carrier, secret, packing, 0);
+    if (!run_stego_job(&job, num_threads))
+    {
+        delete_image(secret);
+        return NULL;
+    }
+    return secret;
+}
+
+Image *extract_packed_image(Image *carrier)
+{
+    return extract_packed_image_parallel(carrier, 1);
+}
+
+unsigned int hide_image_packed(char *secret_image_filename, char *input_filename, char *output_filename, StegoPacking packing, ImageFormat format)
+{
+    if (format == IMAGE_FORMAT_P5)
+    {
+        ERROR("Packed carriers must be saved in an RGB format");
+        return 0;
+    }
+    Image *secret = load_image(secret_image_filename);
+    Image *carrier = load_image_rgb(input_filename);
+    int ok = secret && carrier && embed_packed_image(carrier, secret, packing) && save_image(carrier, output_filename, format);
+    delete_image(secret);
+    delete_image(carrier);
+    return ok ? 1 : 0;
+}
+
+int reveal_image_packed(char *input_filename, char *output_filename, ImageFormat format)
+{
+    Image *carrier = load_image_rgb(input_filename);
+    Image *secret = carrier ? extract_packed_image(carrier) : NULL;
+    int ok = secret && save_image(secret, output_filename, format);
+    delete_image(secret);
+    delete_image(carrier);
+    return ok;
+}
+
+// Opens filename and writes the same header save_image does; returns the descriptor, or -1.
+static int open_binary_output(char *filename, char *magic, unsigned int width, unsigned int height, off_t *raster_offset)
+{
+    int fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (fd < 0)
+    {
+        ERROR("Failed to open file %s for writing", filename);
+        return -1;
+    }
+    char header[64];
+    int length = snprintf(header, sizeof(header), "%s\n%u %u\n255\n", magic, width, height);
+    if (!pwrite_fully(fd, (unsigned char *)header, (size_t)length, 0))
+    {
+        close(fd);
+        return -1;
+    }
+    *raster_offset = length;
+    return fd;
+}
+
+// Byte-identical to hide_image_packed with IMAGE_FORMAT_P6: each worker pwrites the
+// carrier pixels of its chunk as soon as they are embedded.
+unsigned int hide_image_packed_parallel(char *secret_image_filename, char *input_filename, char *output_filename, StegoPacking packing, int num_threads)
+{
+    Image *secret = load_image(secret_image_filename);
+    Image *carrier = load_image_rgb(input_filename);
+    int ok = check_secret_fits(carrier, secret, packing);
+    if (ok)
+    {
+        write_header(carrier, secret, packing);
+        StegoJob job;
+        init_stego_job(&job, carrier, secret, packing, 1);
+        job.fd = open_binary_output(output_filename, "P6", carrier->width, carrier->height, &job.raster_offset);
+        ok = job.fd >= 0 && run_stego_job(&job, num_threads);
+        if (job.fd >= 0 && close(job.fd) != 0) ok = 0;
+        if (!ok) ERROR("Failed to write image %s", output_filename);
+    }
+    delete_image(secret);
+    delete_image(carrier);
+    return ok ? 1 : 0;
+}
+
+// Byte-identical to reveal_image_packed with IMAGE_FORMAT_P5.
+int reveal_image_packed_parallel(char *input_filename, char *output_filename, int num_threads)
+{
+    StegoPacking packing;
+    Image *carrier = load_image_rgb(input_filename);
+    Image *secret = create_revealed_image(carrier, &packing);
+    int ok = secret != NULL;
+    if (ok)
+    {
+        StegoJob job;
+        init_stego_job(&job, carrier, secret, packing, 0);
+        job.fd = open_binary_output(output_filename, "P5", secret->width, secret->height, &job.raster_offset);
+        ok = job.fd >= 0 && run_stego_job(&job, num_threads);
+        if (job.fd >= 0 && close(job.fd) != 0) ok = 0;
+        if (!ok) ERROR("Failed to write image %s", output_filename);
+    }
+    delete_image(secret);
+    delete_image(carrier);
+    return ok;
+}
@@ -0,0 +1,128 @@
+#include <string.h>
+#include "tiled_image.h"
+#include "qtree_stats.h"
+#include "region_sums.h"
+
+#define TILED_IMAGE_TILE_MASK (TILED_IMAGE_TILE_SIZE - 1)
+
+static size_t tile_offset(TiledImage *tiled, unsigned int row, unsigned int col)
+{
+    size_t tile = (size_t)(row >> TILED_IMAGE_TILE_SHIFT) * tiled->tiles_across + (col >> TILED_IMAGE_TILE_SHIFT);
+    return tile * TILED_IMAGE_TILE_PIXELS + ((row & TILED_IMAGE_TILE_MASK) << TILED_IMAGE_TILE_SHIFT) + (col & TILED_IMAGE_TILE_MASK);
+}
+
+// Copies the first sample of every pixel, so RGB images tile their red channel like
+// get_image_intensity reads it.
+TiledImage *create_tiled_image(Image *image)
+{
+    TiledImage *tiled = (TiledImage *)malloc(sizeof(TiledImage));
+    if (!tiled)
+    {
+        ERROR("Memory allocation failed for TiledImage");
+        return NULL;
+    }
+    tiled->width = image->width;
+    tiled->height = image->height;
+    tiled->tiles_across = (image->width + TILED_IMAGE_TILE_MASK) >> TILED_IMAGE_TILE_SHIFT;
+    tiled->tiles_down = (image->height + TILED_IMAGE_TILE_MASK) >> TILED_IMAGE_TILE_SHIFT;
+    tiled->data = (unsigned char *)calloc((size_t)tiled->tiles_across * tiled->tiles_down, TILED_IMAGE_TILE_PIXELS);
+    if (!tiled->data)
+    {
+        ERROR("Memory allocation failed for TiledImage pixels");
+        free(tiled);
+        return NULL;
+    }
+
+    for (unsigned int row = 0; row < image->height; row++)
+    {
+        const unsigned char *src = image->data + (size_t)row * image->width * image->channels;
+        for (unsigned int col = 0; col < image->width; col += TILED_IMAGE_TILE_SIZE)
+        {
+            unsigned char *dst = tiled->data + tile_offset(tiled, row, col);
+            unsigned int span = image->width - col < TILED_IMAGE_TILE_SIZE ? image->width - col : TILED_IMAGE_TILE_SIZE;
+            if (image->channels == 1) memcpy(dst, src + col, span);
+            else for (unsigned int i = 0; i < span; i++) dst[i] = src[(size_t)(col + i) * image->channels];
+        }
+    }
+    return tiled;
+}
+
+// Decodes the file with load_image and retiles it, keeping only the tiled copy.
+TiledImage *load_tiled_image(char *filename)
+{
+    Image *image = load_image(filename);
+    if (!image) return NULL;
+    TiledImage *tiled = create_tiled_image(image);
+    delete_image(image);
+    return tiled;
+}
+
+void delete_tiled_image(TiledImage *tiled)
+{
+    if (tiled)
+    {
+        free(tiled->data);
+        free(tiled);
+    }
+}
+
+unsigned char get_tiled_image_intensity(TiledImage *tiled, unsigned int row, unsigned int col)
+{
+    if (!tiled || row >= tiled->height || col >= tiled->width) return 0;
+    return tiled->data[tile_offset(tiled, row, col)];
+}
+
+// Sums the region one tile at a time, each piece a block of 64-byte-strided rows.
+void get_tiled_region_sums(TiledImage *tiled, int x, int y, int width, int height, unsigned long long *sum, unsigned long long *sum_sq)
+{
+    *sum = 0;
+    *sum_sq = 0;
+    if (width <= 0 || height <= 0) return;
+    QT_STATS_SCAN(width, height, (unsigned long long)width * height);
+    for (int top = y; top < y + height; top = (top | TILED_IMAGE_TILE_MASK) + 1)
+    {
+        int bottom = (top | TILED_IMAGE_TILE_MASK) + 1 < y + height ? (top | TILED_IMAGE_TILE_MASK) + 1 : y + height;
+        for (int left = x; left < x + width; left = (left | TILED_IMAGE_TILE_MASK) + 1)
+        {
+            int right = (left | TILED_IMAGE_TILE_MASK) + 1 < x + width ? (left | TILED_IMAGE_TILE_MASK) + 1 : x + width;
+            const unsigned char *piece = tiled->data + tile_offset(tiled, (unsigned int)top, (unsigned int)left);
+            // Rows spanning the whole tile are back to back, so they are one run of pixels.
+            if (right - left == TILED_IMAGE_TILE_SIZE) add_strided_region_sums(piece, 0, (bottom - top) * TILED_IMAGE_TILE_SIZE, 1, sum, sum_sq);
+            else add_strided_region_sums(piece, TILED_IMAGE_TILE_SIZE, right - left, bottom - top, sum, sum_sq);
+        }
+    }
+}
+
+static QTNode *create_quadtree_tiled_recursive(TiledImage *tiled, QTRegion region, double max_rmse)
+{
+    QTNode *node = (QTNode *)malloc(sizeof(QTNode));
+    if (!node)
+    {
+        ERROR("Memory allocation failed for QTNode");
+        return NULL;
+    }
+    unsigned long long sum, sum_sq;
+    get_tiled_region_sums(tiled, region.col, region.row, region.width, region.height, &sum, &sum_sq);
+    node->is_leaf = evaluate_qt_region_sums(region, sum, sum_sq, max_rmse, &node->intensity);
+    node->width = region.width;
+    node->height = region.height;
+
+    QTRegion children[4];
+    split_qt_region(region, children);
+    for (int i = 0; i < 4; i++)
+    {
+        node->children[i] = !node->is_leaf && children[i].width > 0 ? create_quadtree_tiled_recursive(tiled, children[i], max_rmse) : NULL;
+    }
+    return node;
+}
+
+// Same tree as create_quadtree on the image the tiles came from.
+QTNode *create_quadtree_tiled(TiledImage *tiled, double max_rmse)
+{
+    QT_STATS_START(start);
+    QTRegion region = {0, 0, (int)tiled->width, (int)tiled->height};
+    QTNode *root = create_quadtree_tiled_recursive(tiled, region, max_rmse);
+    QT_STATS_PHASE(QT_STATS_BUILD, start);
+    QT_STATS_TREE(root);
+    return root;
+}